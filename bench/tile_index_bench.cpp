@@ -0,0 +1,123 @@
+// TileIndex vs std::unordered_map micro-benchmark
+// Build: see build_linux.sh bench
+//
+// Square canvases fully populated with 1k, 16k and 64k tiles. Measures random
+// lookups and full iteration, in ns per op; each op reads the first pixel of
+// the tile it finds. Run once with tiles in the dense grid and once with every
+// tile in the overflow table (no grid).
+// Tiles are handles to a set of 1024 shared tiles so 64k entries fit in memory.
+
+#include "../code/tile.cpp"
+#include "../code/tile_pool.cpp"
+#include "../code/tile_index.cpp"
+#include <unordered_map>
+#include <chrono>
+#include <cstdio>
+
+static constexpr u32 DISTINCT_TILES = 1024;
+static constexpr u32 LOOKUPS = 4 * 1024 * 1024;
+
+static f64 nowNs() {
+    using namespace std::chrono;
+    return static_cast<f64>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+// xorshift32, so every run looks up the same coordinates
+struct Random {
+    u32 state = 0x9E3779B9u;
+    u32 next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+struct Result {
+    f64 lookupNs;
+    f64 iterateNs;
+    u64 checksum;
+};
+
+static Result benchMap(u32 side, const std::vector<TileRef>& tiles) {
+    std::unordered_map<u64, TileRef> map;
+    for (u32 ty = 0; ty < side; ++ty) {
+        for (u32 tx = 0; tx < side; ++tx) {
+            map[makeTileKey(static_cast<i32>(tx), static_cast<i32>(ty))] = tiles[(ty * side + tx) % DISTINCT_TILES];
+        }
+    }
+
+    Result result{0, 0, 0};
+    Random random;
+    f64 start = nowNs();
+    for (u32 i = 0; i < LOOKUPS; ++i) {
+        i32 tx = static_cast<i32>(random.next() % side);
+        i32 ty = static_cast<i32>(random.next() % side);
+        auto it = map.find(makeTileKey(tx, ty));
+        if (it != map.end()) result.checksum += it->second->pixels[0];
+    }
+    result.lookupNs = (nowNs() - start) / LOOKUPS;
+
+    u32 passes = std::max(1u, LOOKUPS / (side * side));
+    start = nowNs();
+    for (u32 pass = 0; pass < passes; ++pass) {
+        for (const auto& entry : map) result.checksum += entry.second->pixels[0];
+    }
+    result.iterateNs = (nowNs() - start) / (static_cast<f64>(passes) * side * side);
+    return result;
+}
+
+static Result benchIndex(u32 side, const std::vector<TileRef>& tiles, bool grid) {
+    TileIndex index;
+    if (grid) index.setGridSize(side, side);
+    for (u32 ty = 0; ty < side; ++ty) {
+        for (u32 tx = 0; tx < side; ++tx) {
+            index.put(static_cast<i32>(tx), static_cast<i32>(ty), tiles[(ty * side + tx) % DISTINCT_TILES]);
+        }
+    }
+
+    Result result{0, 0, 0};
+    Random random;
+    f64 start = nowNs();
+    for (u32 i = 0; i < LOOKUPS; ++i) {
+        i32 tx = static_cast<i32>(random.next() % side);
+        i32 ty = static_cast<i32>(random.next() % side);
+        if (const Tile* tile = index.find(tx, ty)) result.checksum += tile->pixels[0];
+    }
+    result.lookupNs = (nowNs() - start) / LOOKUPS;
+
+    u32 passes = std::max(1u, LOOKUPS / (side * side));
+    start = nowNs();
+    for (u32 pass = 0; pass < passes; ++pass) {
+        index.forEach([&](i32, i32, const Tile& tile) { result.checksum += tile.pixels[0]; });
+    }
+    result.iterateNs = (nowNs() - start) / (static_cast<f64>(passes) * side * side);
+    return result;
+}
+
+int main() {
+    std::vector<TileRef> tiles;
+    for (u32 i = 0; i < DISTINCT_TILES; ++i) {
+        auto tile = std::make_unique<Tile>();
+        tile->pixels[0] = i;
+        tiles.emplace_back(std::move(tile));
+    }
+
+    const u32 sides[] = {32, 128, 256};  // 1k, 16k, 64k tiles
+    for (bool grid : {true, false}) {
+        printf("%s\n", grid ? "Dense grid" : "Overflow table only (no grid)");
+        printf("  tiles   random lookup (ns)   iteration (ns)    unordered_map -> TileIndex\n");
+        for (u32 side : sides) {
+            Result map = benchMap(side, tiles);
+            Result index = benchIndex(side, tiles, grid);
+            if (map.checksum != index.checksum) {
+                printf("  checksum mismatch at %u tiles\n", side * side);
+                return 1;
+            }
+            printf("  %5u   %6.1f -> %5.1f       %6.1f -> %5.1f\n", side * side,
+                   map.lookupNs, index.lookupNs, map.iterateNs, index.iterateNs);
+        }
+        printf("\n");
+    }
+    return 0;
+}
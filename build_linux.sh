@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # PixelPlacer Linux build script
-# Usage: ./build_linux.sh [debug]
+# Usage: ./build_linux.sh [debug|bench]
 
 set -e
 
@@ -10,18 +10,25 @@ cd "$(dirname "$0")"
 # Clean previous build
 rm -f pixelplacer pixelplacer_debug
 
-if [ "$1" = "debug" ]; then
+if [ "$1" = "bench" ]; then
+    echo "Building benchmarks..."
+    for src in bench/*.cpp; do
+        name="$(basename "$src" .cpp)"
+        g++ -std=c++17 -O2 -DNDEBUG -Icode "$src" -pthread -o "bench/$name"
+        echo "Built: bench/$name"
+    done
+elif [ "$1" = "debug" ]; then
     echo "Building debug version..."
     g++ -std=c++17 -g -O0 -DUNITY_BUILD -Wall -Wextra \
         code/main.cpp \
-        -lX11 \
+        -lX11 -lXext -pthread \
         -o pixelplacer_debug
     echo "Built: pixelplacer_debug"
 else
     echo "Building release version..."
     g++ -std=c++17 -O3 -DNDEBUG -DUNITY_BUILD \
         code/main.cpp \
-        -lX11 \
+        -lX11 -lXext -pthread \
         -o pixelplacer
     echo "Built: pixelplacer"
 fi
@@ -0,0 +1,399 @@
+#include "adjustment.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+void AdjustmentLut::evaluate(AdjustmentType type, const AdjustmentParams& settings, f32& r, f32& g, f32& b) {
+    switch (type) {
+        case AdjustmentType::BrightnessContrast: {
+            const auto* params = std::get_if<BrightnessContrastParams>(&settings);
+            if (params) {
+                f32 brightness = params->brightness / 100.0f;
+                f32 contrast = (params->contrast + 100.0f) / 100.0f;
+
+                r = (r - 0.5f) * contrast + 0.5f + brightness;
+                g = (g - 0.5f) * contrast + 0.5f + brightness;
+                b = (b - 0.5f) * contrast + 0.5f + brightness;
+            }
+            break;
+        }
+
+        case AdjustmentType::HueSaturation: {
+            const auto* params = std::get_if<HueSaturationParams>(&settings);
+            if (params) {
+                // Convert to HSL
+                f32 maxC = std::max({r, g, b});
+                f32 minC = std::min({r, g, b});
+                f32 l = (maxC + minC) / 2.0f;
+
+                if (maxC != minC) {
+                    f32 d = maxC - minC;
+                    f32 s = l > 0.5f ? d / (2.0f - maxC - minC) : d / (maxC + minC);
+
+                    f32 h = 0;
+                    if (maxC == r) {
+                        h = (g - b) / d + (g < b ? 6.0f : 0.0f);
+                    } else if (maxC == g) {
+                        h = (b - r) / d + 2.0f;
+                    } else {
+                        h = (r - g) / d + 4.0f;
+                    }
+                    h /= 6.0f;
+
+                    // Apply adjustments
+                    h += params->hue / 360.0f;
+                    while (h < 0) h += 1.0f;
+                    while (h >= 1.0f) h -= 1.0f;
+
+                    s *= 1.0f + params->saturation / 100.0f;
+                    s = clamp(s, 0.0f, 1.0f);
+
+                    l += params->lightness / 100.0f;
+                    l = clamp(l, 0.0f, 1.0f);
+
+                    // Convert back to RGB
+                    auto hue2rgb = [](f32 p, f32 q, f32 t) {
+                        if (t < 0) t += 1.0f;
+                        if (t > 1) t -= 1.0f;
+                        if (t < 1.0f/6.0f) return p + (q - p) * 6.0f * t;
+                        if (t < 1.0f/2.0f) return q;
+                        if (t < 2.0f/3.0f) return p + (q - p) * (2.0f/3.0f - t) * 6.0f;
+                        return p;
+                    };
+
+                    f32 q = l < 0.5f ? l * (1.0f + s) : l + s - l * s;
+                    f32 p = 2.0f * l - q;
+
+                    r = hue2rgb(p, q, h + 1.0f/3.0f);
+                    g = hue2rgb(p, q, h);
+                    b = hue2rgb(p, q, h - 1.0f/3.0f);
+                }
+            }
+            break;
+        }
+
+        case AdjustmentType::Invert: {
+            r = 1.0f - r;
+            g = 1.0f - g;
+            b = 1.0f - b;
+            break;
+        }
+
+        case AdjustmentType::Exposure: {
+            const auto* params = std::get_if<ExposureParams>(&settings);
+            if (params) {
+                f32 exposure = std::pow(2.0f, params->exposure);
+                r = std::pow(r * exposure + params->offset, 1.0f / params->gamma);
+                g = std::pow(g * exposure + params->offset, 1.0f / params->gamma);
+                b = std::pow(b * exposure + params->offset, 1.0f / params->gamma);
+            }
+            break;
+        }
+
+        case AdjustmentType::BlackAndWhite: {
+            const auto* params = std::get_if<BlackAndWhiteParams>(&settings);
+            if (params) {
+                // Simple grayscale conversion weighted by color channels
+                f32 gray = r * (params->reds / 100.0f) +
+                           g * (params->greens / 100.0f) +
+                           b * (params->blues / 100.0f);
+                gray = clamp(gray, 0.0f, 1.0f);
+
+                if (params->tintAmount > 0) {
+                    // Apply tint (simplified)
+                    f32 t = params->tintAmount / 100.0f;
+                    // Tint towards sepia-like color based on hue
+                    f32 tintR = 1.0f, tintG = 0.9f, tintB = 0.7f;
+                    r = gray * (1.0f - t) + gray * tintR * t;
+                    g = gray * (1.0f - t) + gray * tintG * t;
+                    b = gray * (1.0f - t) + gray * tintB * t;
+                } else {
+                    r = g = b = gray;
+                }
+            }
+            break;
+        }
+
+        case AdjustmentType::TemperatureTint: {
+            const auto* params = std::get_if<TemperatureTintParams>(&settings);
+            if (params) {
+                // Temperature: negative = cooler (blue), positive = warmer (orange)
+                f32 temp = params->temperature / 100.0f;
+                // Tint: negative = green, positive = magenta
+                f32 tint = params->tint / 100.0f;
+
+                r += temp * 0.3f;
+                b -= temp * 0.3f;
+                g -= tint * 0.3f;
+                r += tint * 0.15f;
+                b += tint * 0.15f;
+            }
+            break;
+        }
+
+        case AdjustmentType::Vibrance: {
+            const auto* params = std::get_if<VibranceParams>(&settings);
+            if (params) {
+                // Vibrance increases saturation of less-saturated colors more
+                f32 maxC = std::max({r, g, b});
+                f32 minC = std::min({r, g, b});
+                f32 sat = (maxC > 0) ? (maxC - minC) / maxC : 0.0f;
+
+                // Less saturated colors get more boost
+                f32 boost = (1.0f - sat) * (params->vibrance / 100.0f);
+                f32 avg = (r + g + b) / 3.0f;
+
+                r = r + (r - avg) * boost;
+                g = g + (g - avg) * boost;
+                b = b + (b - avg) * boost;
+            }
+            break;
+        }
+
+        case AdjustmentType::ColorBalance: {
+            const auto* params = std::get_if<ColorBalanceParams>(&settings);
+            if (params) {
+                // Determine luminance to weight shadows/midtones/highlights
+                f32 lum = 0.299f * r + 0.587f * g + 0.114f * b;
+
+                // Shadow influence (more for dark pixels)
+                f32 shadowWeight = 1.0f - clamp(lum * 2.0f, 0.0f, 1.0f);
+                // Highlight influence (more for bright pixels)
+                f32 highlightWeight = clamp((lum - 0.5f) * 2.0f, 0.0f, 1.0f);
+                // Midtone influence (peak at middle luminance)
+                f32 midtoneWeight = 1.0f - std::abs(lum - 0.5f) * 2.0f;
+                midtoneWeight = clamp(midtoneWeight, 0.0f, 1.0f);
+
+                // Apply shadows adjustments
+                r += shadowWeight * params->shadowsCyanRed / 100.0f * 0.5f;
+                g += shadowWeight * params->shadowsMagentaGreen / 100.0f * 0.5f;
+                b += shadowWeight * params->shadowsYellowBlue / 100.0f * 0.5f;
+
+                // Apply midtones adjustments
+                r += midtoneWeight * params->midtonesCyanRed / 100.0f * 0.5f;
+                g += midtoneWeight * params->midtonesMagentaGreen / 100.0f * 0.5f;
+                b += midtoneWeight * params->midtonesYellowBlue / 100.0f * 0.5f;
+
+                // Apply highlights adjustments
+                r += highlightWeight * params->highlightsCyanRed / 100.0f * 0.5f;
+                g += highlightWeight * params->highlightsMagentaGreen / 100.0f * 0.5f;
+                b += highlightWeight * params->highlightsYellowBlue / 100.0f * 0.5f;
+            }
+            break;
+        }
+
+        case AdjustmentType::HighlightsShadows: {
+            const auto* params = std::get_if<HighlightsShadowsParams>(&settings);
+            if (params) {
+                f32 lum = 0.299f * r + 0.587f * g + 0.114f * b;
+
+                // Shadow recovery (brighten dark areas)
+                f32 shadowMask = 1.0f - clamp(lum * 2.0f, 0.0f, 1.0f);
+                f32 shadowBoost = shadowMask * params->shadows / 100.0f;
+
+                // Highlight recovery (darken bright areas)
+                f32 highlightMask = clamp((lum - 0.5f) * 2.0f, 0.0f, 1.0f);
+                f32 highlightBoost = -highlightMask * params->highlights / 100.0f;
+
+                f32 adjustment = shadowBoost + highlightBoost;
+                r += adjustment;
+                g += adjustment;
+                b += adjustment;
+            }
+            break;
+        }
+
+        case AdjustmentType::Levels: {
+            const auto* params = std::get_if<LevelsParams>(&settings);
+            if (params) {
+                // Input levels: remap input range
+                f32 inBlack = params->inputBlack / 255.0f;
+                f32 inWhite = params->inputWhite / 255.0f;
+                f32 gamma = params->inputGamma;
+
+                // Output levels
+                f32 outBlack = params->outputBlack / 255.0f;
+                f32 outWhite = params->outputWhite / 255.0f;
+
+                auto applyLevels = [&](f32 val) {
+                    // Input mapping
+                    val = (val - inBlack) / (inWhite - inBlack);
+                    val = clamp(val, 0.0f, 1.0f);
+                    // Gamma
+                    val = std::pow(val, 1.0f / gamma);
+                    // Output mapping
+                    val = val * (outWhite - outBlack) + outBlack;
+                    return val;
+                };
+
+                r = applyLevels(r);
+                g = applyLevels(g);
+                b = applyLevels(b);
+            }
+            break;
+        }
+
+        default:
+            // Unknown adjustment type
+            break;
+    }
+}
+
+// Same type and the same param bytes (the composite cache signature hashes
+// params the same way)
+static bool sameSettings(AdjustmentType typeA, const AdjustmentParams& a,
+                         AdjustmentType typeB, const AdjustmentParams& b) {
+    if (typeA != typeB || a.index() != b.index()) return false;
+    return std::visit([&](const auto& params) {
+        using T = std::decay_t<decltype(params)>;
+        if constexpr (std::is_empty_v<T>) {
+            return true;
+        } else {
+            return std::memcmp(&params, &std::get<T>(b), sizeof(T)) == 0;
+        }
+    }, a);
+}
+
+// Clamp a channel and convert it to 8 bits the way the per-pixel path always has
+static u8 toByte(f32 value) {
+    return static_cast<u8>(clamp(value, 0.0f, 1.0f) * 255.0f);
+}
+
+// Each output channel depends only on the same input channel
+static bool isSeparable(AdjustmentType type) {
+    return type == AdjustmentType::BrightnessContrast ||
+           type == AdjustmentType::TemperatureTint ||
+           type == AdjustmentType::Exposure ||
+           type == AdjustmentType::Levels ||
+           type == AdjustmentType::Invert;
+}
+
+u32 AdjustmentLut::evaluateSteps(f32 r, f32 g, f32 b, bool roundSteps) const {
+    for (size_t i = 0; i < builtSteps.size(); ++i) {
+        if (i > 0) {
+            // Each step starts from a valid color, as it would applied alone
+            r = clamp(r, 0.0f, 1.0f);
+            g = clamp(g, 0.0f, 1.0f);
+            b = clamp(b, 0.0f, 1.0f);
+            if (roundSteps) {
+                r = toByte(r) / 255.0f;
+                g = toByte(g) / 255.0f;
+                b = toByte(b) / 255.0f;
+            }
+        }
+        evaluate(builtSteps[i].type, builtSteps[i].params, r, g, b);
+    }
+    return (static_cast<u32>(toByte(r)) << 24) | (static_cast<u32>(toByte(g)) << 16) |
+           (static_cast<u32>(toByte(b)) << 8);
+}
+
+u32 AdjustmentLut::applyExact(u32 pixel) const {
+    return evaluateSteps((pixel >> 24) / 255.0f, ((pixel >> 16) & 0xFF) / 255.0f,
+                         ((pixel >> 8) & 0xFF) / 255.0f, false) | (pixel & 0xFF);
+}
+
+void AdjustmentLut::update(AdjustmentType type, const AdjustmentParams& params) {
+    if (built && builtSteps.size() == 1 &&
+        sameSettings(type, params, builtSteps[0].type, builtSteps[0].params)) {
+        return;
+    }
+    builtSteps.assign(1, AdjustmentStep{type, params});
+    build();
+}
+
+void AdjustmentLut::update(const std::vector<AdjustmentStep>& steps) {
+    bool same = built && steps.size() == builtSteps.size();
+    for (size_t i = 0; same && i < steps.size(); ++i) {
+        same = sameSettings(steps[i].type, steps[i].params, builtSteps[i].type, builtSteps[i].params);
+    }
+    if (same) return;
+    builtSteps = steps;
+    build();
+}
+
+void AdjustmentLut::build() {
+    built = true;
+
+    bool separable = true;
+    for (const AdjustmentStep& step : builtSteps) {
+        separable = separable && isSeparable(step.type);
+    }
+
+    if (separable) {
+        // Every channel only sees itself, so a gray input gives all three
+        // curves at once
+        cube.clear();
+        exactCells.clear();
+        for (u32 v = 0; v < 256; ++v) {
+            u32 color = evaluateSteps(v / 255.0f, v / 255.0f, v / 255.0f, true);
+            red[v] = static_cast<u8>(color >> 24);
+            green[v] = static_cast<u8>(color >> 16);
+            blue[v] = static_cast<u8>(color >> 8);
+        }
+        return;
+    }
+
+    // Long chains take a while to evaluate, so blue slices are spread over
+    // the thread pool
+    ThreadPool& pool = ThreadPool::instance();
+    const u32 last = CUBE_SIZE - 1;
+    cube.resize(CUBE_SIZE * CUBE_SIZE * CUBE_SIZE);
+    pool.parallelFor(CUBE_SIZE, [&](u32 bi) {
+        for (u32 gi = 0; gi < CUBE_SIZE; ++gi) {
+            for (u32 ri = 0; ri < CUBE_SIZE; ++ri) {
+                cube[ri + gi * CUBE_SIZE + bi * CUBE_SIZE * CUBE_SIZE] =
+                    evaluateSteps(static_cast<f32>(ri) / last, static_cast<f32>(gi) / last,
+                                  static_cast<f32>(bi) / last, false);
+            }
+        }
+    });
+
+    // Channel value v sits at v * last / 255 on the grid
+    for (u32 v = 0; v < 256; ++v) {
+        u32 position = (v * last * 256 + 127) / 255;   // Grid units, 8 fractional bits
+        u32 index = std::min(position >> 8, last - 1);
+        cell[v] = static_cast<u8>(index);
+        weight[v] = static_cast<u16>(position - index * 256);
+    }
+
+    // Probe each cell a quarter of the way in from every corner and flag the
+    // ones where interpolation drifts too far from the real curve
+    const u32 cells = last * last * last;
+    exactCells.assign((cells + 31) / 32, 0);
+    u32 probes[CUBE_SIZE - 1][2];
+    for (u32 i = 0; i < last; ++i) {
+        probes[i][0] = ((4 * i + 1) * 255 + 2 * last) / (4 * last);
+        probes[i][1] = ((4 * i + 3) * 255 + 2 * last) / (4 * last);
+    }
+
+    auto drifts = [&](u32 r, u32 g, u32 b) {
+        u32 expected = applyExact((r << 24) | (g << 16) | (b << 8) | 0xFF);
+        u32 sampled = sampleCube(r, g, b);
+        for (u32 shift = 8; shift < 32; shift += 8) {
+            i32 difference = static_cast<i32>((expected >> shift) & 0xFF) -
+                             static_cast<i32>((sampled >> shift) & 0xFF);
+            if (std::abs(difference) > static_cast<i32>(MAX_CUBE_ERROR)) return true;
+        }
+        return false;
+    };
+
+    // A blue slice of cells covers whole words of exactCells, so slices can
+    // be checked in parallel
+    static_assert((CUBE_SIZE - 1) % 32 == 0, "cell rows must fill whole words");
+    pool.parallelFor(last, [&](u32 bi) {
+        for (u32 gi = 0; gi < last; ++gi) {
+            for (u32 ri = 0; ri < last; ++ri) {
+                for (u32 corner = 0; corner < 8; ++corner) {
+                    if (drifts(probes[ri][corner & 1], probes[gi][(corner >> 1) & 1],
+                               probes[bi][corner >> 2])) {
+                        u32 index = ri + gi * last + bi * last * last;
+                        exactCells[index >> 5] |= 1u << (index & 31);
+                        break;
+                    }
+                }
+            }
+        }
+    });
+}
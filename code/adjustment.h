@@ -0,0 +1,226 @@
+#ifndef _H_ADJUSTMENT_
+#define _H_ADJUSTMENT_
+
+#include "types.h"
+#include "primitives.h"
+#include <variant>
+#include <vector>
+#include <algorithm>
+
+// Adjustment types
+enum class AdjustmentType {
+    BrightnessContrast,
+    TemperatureTint,
+    HueSaturation,
+    Vibrance,
+    ColorBalance,
+    HighlightsShadows,
+    Exposure,
+    Levels,
+    Invert,
+    BlackAndWhite
+};
+
+// Adjustment parameters for each type
+struct BrightnessContrastParams {
+    f32 brightness = 0.0f;  // -100 to 100
+    f32 contrast = 0.0f;    // -100 to 100
+};
+
+struct TemperatureTintParams {
+    f32 temperature = 0.0f; // -100 to 100
+    f32 tint = 0.0f;        // -100 to 100
+};
+
+struct HueSaturationParams {
+    f32 hue = 0.0f;         // -180 to 180
+    f32 saturation = 0.0f;  // -100 to 100
+    f32 lightness = 0.0f;   // -100 to 100
+};
+
+struct VibranceParams {
+    f32 vibrance = 0.0f;    // -100 to 100
+};
+
+struct ColorBalanceParams {
+    f32 shadowsCyanRed = 0.0f;
+    f32 shadowsMagentaGreen = 0.0f;
+    f32 shadowsYellowBlue = 0.0f;
+    f32 midtonesCyanRed = 0.0f;
+    f32 midtonesMagentaGreen = 0.0f;
+    f32 midtonesYellowBlue = 0.0f;
+    f32 highlightsCyanRed = 0.0f;
+    f32 highlightsMagentaGreen = 0.0f;
+    f32 highlightsYellowBlue = 0.0f;
+};
+
+struct HighlightsShadowsParams {
+    f32 highlights = 0.0f;  // -100 to 100
+    f32 shadows = 0.0f;     // -100 to 100
+};
+
+struct ExposureParams {
+    f32 exposure = 0.0f;    // -5 to 5
+    f32 offset = 0.0f;      // -0.1 to 0.1
+    f32 gamma = 1.0f;       // 0.01 to 9.99
+};
+
+struct LevelsParams {
+    // Input levels: black point, gamma, white point (0-255)
+    f32 inputBlack = 0.0f;
+    f32 inputGamma = 1.0f;
+    f32 inputWhite = 255.0f;
+    // Output levels
+    f32 outputBlack = 0.0f;
+    f32 outputWhite = 255.0f;
+};
+
+struct InvertParams {
+    // No parameters needed
+};
+
+struct BlackAndWhiteParams {
+    f32 reds = 40.0f;
+    f32 yellows = 60.0f;
+    f32 greens = 40.0f;
+    f32 cyans = 60.0f;
+    f32 blues = 20.0f;
+    f32 magentas = 80.0f;
+    f32 tintHue = 0.0f;
+    f32 tintAmount = 0.0f;
+};
+
+// Variant type for all adjustment params
+using AdjustmentParams = std::variant<
+    BrightnessContrastParams,
+    TemperatureTintParams,
+    HueSaturationParams,
+    VibranceParams,
+    ColorBalanceParams,
+    HighlightsShadowsParams,
+    ExposureParams,
+    LevelsParams,
+    InvertParams,
+    BlackAndWhiteParams
+>;
+
+// One adjustment of a chain applied in order
+struct AdjustmentStep {
+    AdjustmentType type;
+    AdjustmentParams params;
+};
+
+// An adjustment's settings compiled into lookup tables, so applying it costs
+// a few table reads instead of float math per pixel. Adjustments where each
+// output channel depends only on the same input channel get a 256-entry table
+// per channel, which reproduces the float math exactly. The others
+// (HueSaturation, Vibrance, ColorBalance, BlackAndWhite, HighlightsShadows)
+// sample an RGB cube. Cells the interpolation gets badly wrong (HueSaturation
+// blows up saturation next to white) are flagged while building and fall back
+// to the float math.
+// A chain of adjustments compiles into one set of tables the same way. Chains
+// of per-channel adjustments give exactly what applying them one after another
+// would; chains through a cube skip the rounding between steps.
+class AdjustmentLut {
+public:
+    static constexpr u32 CUBE_SIZE = 33;   // Grid points per axis
+    static constexpr u32 MAX_CUBE_ERROR = 2; // Per channel, before a cell is evaluated exactly
+
+    // Rebuild the tables if type or params differ from the last build. Cube
+    // builds use the thread pool, so don't call this from a pool job.
+    void update(AdjustmentType type, const AdjustmentParams& params);
+
+    // Same for a chain of adjustments, first applied first
+    void update(const std::vector<AdjustmentStep>& steps);
+
+    // Adjust one pixel; alpha is kept and transparent pixels are left alone
+    u32 apply(u32 pixel) const {
+        if ((pixel & 0xFF) == 0) return pixel;
+        u32 r = pixel >> 24;
+        u32 g = (pixel >> 16) & 0xFF;
+        u32 b = (pixel >> 8) & 0xFF;
+        if (!cube.empty()) {
+            u32 index = cell[r] + cell[g] * (CUBE_SIZE - 1) + cell[b] * (CUBE_SIZE - 1) * (CUBE_SIZE - 1);
+            if (exactCells[index >> 5] & (1u << (index & 31))) return applyExact(pixel);
+            return sampleCube(r, g, b) | (pixel & 0xFF);
+        }
+        return (static_cast<u32>(red[r]) << 24) | (static_cast<u32>(green[g]) << 16) |
+               (static_cast<u32>(blue[b]) << 8) | (pixel & 0xFF);
+    }
+
+    // Runs of one color are common (flat fills, solid tiles), so the last
+    // result is reused while the input repeats
+    void applyRow(u32* pixels, u32 count) const {
+        u32 previous = 0, result = 0;
+        for (u32 i = 0; i < count; ++i) {
+            u32 pixel = pixels[i];
+            if (pixel != previous) {
+                previous = pixel;
+                result = apply(pixel);
+            }
+            pixels[i] = result;
+        }
+    }
+
+    // The adjustment math on normalized (0-1) channels, unclamped. The tables
+    // are built from this.
+    static void evaluate(AdjustmentType type, const AdjustmentParams& params, f32& r, f32& g, f32& b);
+
+private:
+    // Float math for one pixel, for cells the cube can't represent
+    u32 applyExact(u32 pixel) const;
+
+    // Tetrahedral interpolation: the cell is split into six tetrahedra along
+    // its gray diagonal and the one holding the color mixes four corners.
+    // Weights are all positive and sum to 256, so red/blue and green go
+    // through the multiplies in pairs, one channel per 16-bit half.
+    u32 sampleCube(u32 r, u32 g, u32 b) const {
+        const u32 strideG = CUBE_SIZE;
+        const u32 strideB = CUBE_SIZE * CUBE_SIZE;
+        const u32* p = cube.data() + cell[r] + cell[g] * strideG + cell[b] * strideB;
+
+        // The tetrahedron walks from the low corner along the axis the color
+        // is furthest along, then the middle one, then the last. Ties give a
+        // corner zero weight, so any of the tied axes will do.
+        u32 wr = weight[r], wg = weight[g], wb = weight[b];
+        u32 w1 = std::max(wr, std::max(wg, wb));
+        u32 w3 = std::min(wr, std::min(wg, wb));
+        u32 w2 = wr + wg + wb - w1 - w3;
+        u32 first = wr == w1 ? 1 : (wg == w1 ? strideG : strideB);
+        u32 last = wb == w3 ? strideB : (wg == w3 ? strideG : 1);
+        const u32 corner = 1 + strideG + strideB;
+
+        u32 c0 = p[0], c1 = p[first], c2 = p[corner - last], c3 = p[corner];
+        u32 k0 = 256 - w1, k1 = w1 - w2, k2 = w2 - w3, k3 = w3;
+        const u32 mask = 0x00FF00FF;
+        u32 rb = ((c0 >> 8) & mask) * k0 + ((c1 >> 8) & mask) * k1 +
+                 ((c2 >> 8) & mask) * k2 + ((c3 >> 8) & mask) * k3 + 0x00800080;
+        u32 green16 = ((c0 >> 16) & 0xFF) * k0 + ((c1 >> 16) & 0xFF) * k1 +
+                ((c2 >> 16) & 0xFF) * k2 + ((c3 >> 16) & 0xFF) * k3 + 0x80;
+        return (rb & 0xFF00FF00) | ((green16 & 0xFF00) << 8);
+    }
+
+    // Run the chain in float and pack the result as 0xRRGGBB00. roundSteps
+    // rounds to 8 bits between steps, as applying each step's own tables
+    // would; without it the chain is a smooth function the cube can follow.
+    u32 evaluateSteps(f32 r, f32 g, f32 b, bool roundSteps) const;
+
+    void build();
+
+    bool built = false;
+    std::vector<AdjustmentStep> builtSteps;
+
+    // Per-channel tables
+    u8 red[256];
+    u8 green[256];
+    u8 blue[256];
+
+    // RGB cube, red fastest, entries packed 0xRRGGBB00. Empty when the
+    // channel tables are used.
+    std::vector<u32> cube;
+    u8 cell[256];      // Grid cell below each channel value
+    u16 weight[256];   // Position inside that cell, 0..256
+    std::vector<u32> exactCells;   // One bit per cell, red fastest
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "app_state.h"
 #include "document.h"
+#include "tile_pool.h"
 #include "config.h"
+#include <cstdio>
 
 // Runtime UI scale definition
 namespace Config {
@@ -34,8 +36,17 @@ void AppState::closeDocument(Document* doc) {
 void AppState::closeDocument(i32 index) {
     if (index < 0 || index >= static_cast<i32>(documents.size())) return;
 
+    if (onDocumentClosing) onDocumentClosing(documents[index].get());
     documents.erase(documents.begin() + index);
 
+    // Hand the closed document's tile memory back to the system
+    TiledCanvas::releaseUnusedSolidTiles();
+    TilePool::instance().trim();
+
+    TilePool::Stats stats = TilePool::instance().getStats();
+    fprintf(stderr, "Tile pool: %zu tiles in use (peak %zu), %zu slabs / %zu KB reserved, %zu free\n",
+            stats.tilesInUse, stats.peakTilesInUse, stats.slabCount, stats.reservedBytes / 1024, stats.freeTiles);
+
     // Update active document
     if (documents.empty()) {
         activeDocument = nullptr;
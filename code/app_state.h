@@ -3,6 +3,8 @@
 
 #include "types.h"
 #include "primitives.h"
+#include "rect_region.h"
+#include "config.h"
 #include "tiled_canvas.h"
 #include "brush_tip.h"
 #include <vector>
@@ -18,47 +20,56 @@ class Tool;
 
 // Dirty region tracking for optimized rendering
 struct DirtyRegion {
-    std::vector<Recti> rects;
+    RectRegion region;
     bool fullRedraw = true;  // Start with full redraw
 
     void markDirty(const Recti& r) {
         if (fullRedraw) return;  // Already doing full redraw
-        if (r.w <= 0 || r.h <= 0) return;
 
-        // Merge with existing rects if overlapping, or add new
-        // Simple approach: just add to list (could optimize with merging)
-        rects.push_back(r);
-
-        // If we have too many small rects, just do full redraw
-        if (rects.size() > 16) {
-            markFullRedraw();
-        }
+        // Each rect is drawn in its own pass over the widget tree and
+        // uploaded on its own, so past a handful of them it's cheaper to
+        // cover a few extra pixels
+        region.unite(r);
+        region.simplify(Config::DIRTY_REGION_MAX_RECTS);
     }
 
     void markFullRedraw() {
         fullRedraw = true;
-        rects.clear();
+        region.clear();
     }
 
     void clear() {
         fullRedraw = false;
-        rects.clear();
+        region.clear();
     }
 
-    Recti bounds() const {
-        if (rects.empty()) return Recti(0, 0, 0, 0);
-        i32 x0 = rects[0].x, y0 = rects[0].y;
-        i32 x1 = x0 + rects[0].w, y1 = y0 + rects[0].h;
-        for (size_t i = 1; i < rects.size(); ++i) {
-            x0 = std::min(x0, rects[i].x);
-            y0 = std::min(y0, rects[i].y);
-            x1 = std::max(x1, rects[i].x + rects[i].w);
-            y1 = std::max(y1, rects[i].y + rects[i].h);
+    // Drop what's outside the frame, and redraw everything once the region
+    // covers enough of it that one pass is cheaper than several
+    void fitToFrame(i32 width, i32 height) {
+        if (fullRedraw) return;
+        region.intersect(Recti(0, 0, width, height));
+        i64 frameArea = static_cast<i64>(width) * height;
+        if (static_cast<f32>(region.area()) > frameArea * Config::DIRTY_REGION_FULL_REDRAW_COVERAGE) {
+            markFullRedraw();
         }
-        return Recti(x0, y0, x1 - x0, y1 - y0);
     }
 };
 
+// Redraw request. Code that changes the screen without saying where sets it
+// to true, which redraws the whole window; markDirty() sets it while keeping
+// the frame limited to the dirty rects.
+struct RedrawFlag {
+    bool requested = true;
+    bool located = false;   // Every change this frame came through markDirty()
+
+    RedrawFlag& operator=(bool value) {
+        requested = value;
+        located = false;
+        return *this;
+    }
+    operator bool() const { return requested; }
+};
+
 // Clipboard data for copy/paste
 struct Clipboard {
     std::unique_ptr<TiledCanvas> pixels;
@@ -162,13 +173,22 @@ struct AppState {
     bool showProperties = true;
     bool showLayers = true;
 
+    // Outline document pixels when zoomed in
+    bool showPixelGrid = false;
+
     // Window state
     bool running = true;
-    bool needsRedraw = true;
+    RedrawFlag needsRedraw;
 
     // Dirty region tracking for partial redraws
     DirtyRegion dirtyRegion;
 
+    // Time of the last click, wheel or key press (Platform::getMilliseconds)
+    u64 lastInputTime = 0;
+    // Area of a document view waiting on its renderer (a frame in flight or a
+    // preview to refine); frame() redraws it on the next frame
+    Recti pendingRefine;
+
     // Mouse state
     Vec2 mousePosition;
     bool mouseDown = false;
@@ -210,6 +230,10 @@ struct AppState {
     // Callback for when active document changes (for UI updates)
     std::function<void()> onActiveDocumentChanged;
 
+    // Callback before a document is destroyed, so views (and the render
+    // thread's snapshot of it) can let go of its tiles first
+    std::function<void(Document*)> onDocumentClosing;
+
     // Color swapping
     void swapColors();
     void resetColors();
@@ -227,11 +251,22 @@ inline void requestRedraw() {
 
 // Helper to mark a specific region dirty - for partial updates
 inline void markDirty(const Recti& rect) {
+    if (rect.w <= 0 || rect.h <= 0) return;
     AppState& state = getAppState();
-    state.needsRedraw = true;
+    if (!state.needsRedraw) {
+        state.needsRedraw.requested = true;
+        state.needsRedraw.located = true;
+    }
     state.dirtyRegion.markDirty(rect);
 }
 
+// True when this frame only needs the dirty rects redrawn and presented
+inline bool isPartialRedraw() {
+    const AppState& state = getAppState();
+    return state.needsRedraw.located && !state.dirtyRegion.fullRedraw &&
+           !state.dirtyRegion.region.isEmpty();
+}
+
 // Evaluate cubic bezier pressure curve
 // Input: raw pressure (0-1), control points
 // Output: adjusted pressure (0-1)
@@ -32,6 +32,7 @@ bool Application::initialize(u32 width, u32 height, const char* title) {
     drawableHeight = windowHeight;
 
     framebuffer.resize(drawableWidth, drawableHeight);
+    fprintf(stderr, "Blend spans: %s\n", Blend::spanImplementation());
 
     // Load default font
     loadDefaultFont();
@@ -263,9 +264,12 @@ void Application::frame() {
         rebuildUIWithScale(state.pendingScaleValue);
     }
 
-    // Force redraw if there's an active selection (for marching ants animation)
+    // Force redraw when the marching ants move on a step
     // Mark only the selection border region as dirty, not the whole screen
-    if (state.activeDocument && state.activeDocument->selection.hasSelection) {
+    u64 antsStep = Platform::getMilliseconds() / Config::MARCHING_ANTS_STEP_MS;
+    if (state.activeDocument && state.activeDocument->selection.hasSelection &&
+        antsStep != marchingAntsStep) {
+        marchingAntsStep = antsStep;
         if (!state.needsRedraw) {
             // Only selection animation - mark selection bounds dirty
             if (auto* mainWindow = dynamic_cast<MainWindow*>(rootWidget.get())) {
@@ -277,12 +281,31 @@ void Application::frame() {
         }
     }
 
-    if (state.needsRedraw) {
+#ifdef __EMSCRIPTEN__
+    // requestAnimationFrame already paces frames
+    bool presentDue = true;
+#else
+    // Coalesce redraws to the display refresh; events are still handled
+    // as they arrive and the redraw waits in needsRedraw
+    bool presentDue = Platform::getMilliseconds() >= lastPresentTime + Config::FRAME_INTERVAL_MS;
+#endif
+
+    if (state.needsRedraw && presentDue) {
+        state.dirtyRegion.fitToFrame(static_cast<i32>(framebuffer.width),
+                                     static_cast<i32>(framebuffer.height));
         render();
         present();
+        lastPresentTime = Platform::getMilliseconds();
         state.needsRedraw = false;
         state.dirtyRegion.clear();
     }
+
+    // Keep frames coming while a document view refines its preview. Input
+    // is still handled first each frame; the view spends a fixed budget.
+    if (!state.pendingRefine.isEmpty()) {
+        markDirty(state.pendingRefine);
+        state.pendingRefine = Recti();
+    }
 }
 
 void Application::run() {
@@ -299,17 +322,32 @@ void Application::run() {
     while (state.running) {
         frame();
 
-        // Small delay to prevent 100% CPU usage
-        // Use longer delay when not animating to save power
-        if (state.activeDocument && state.activeDocument->selection.hasSelection) {
-            Platform::sleepMs(16);  // ~60 FPS for animation
-        } else {
-            Platform::sleepMs(1);
-        }
+        // Sleep on the window's event queue until input arrives or the
+        // next redraw or animation step is due
+        window->waitForEvents(waitTimeout());
     }
 #endif
 }
 
+i32 Application::waitTimeout() const {
+    const AppState& state = getAppState();
+    u64 now = Platform::getMilliseconds();
+
+    // A redraw is waiting for the next refresh (or a document view for its
+    // renderer, which asks again every frame)
+    if (state.needsRedraw) {
+        u64 due = lastPresentTime + Config::FRAME_INTERVAL_MS;
+        return due > now ? static_cast<i32>(due - now) : 0;
+    }
+
+    // Wake for the next marching ants step
+    if (state.activeDocument && state.activeDocument->selection.hasSelection) {
+        return static_cast<i32>(Config::MARCHING_ANTS_STEP_MS - now % Config::MARCHING_ANTS_STEP_MS);
+    }
+
+    return -1;
+}
+
 void Application::shutdown() {
     rootWidget.reset();
     window.reset();  // Platform window destructor handles cleanup
@@ -317,6 +355,7 @@ void Application::shutdown() {
 
 void Application::handleKeyDown(i32 keyCode, i32 scanCode, bool repeat) {
     AppState& state = getAppState();
+    state.lastInputTime = Platform::getMilliseconds();
 
     // Space key for temporary pan
     if (keyCode == Key::SPACE) {
@@ -386,6 +425,7 @@ i32 Application::getResizeDirection(i32 x, i32 y) const {
 
 void Application::handleMouseDown(i32 x, i32 y, MouseButton button) {
     AppState& state = getAppState();
+    state.lastInputTime = Platform::getMilliseconds();
 
     // Check for window resize edges first (only with left button, not when maximized)
     if (button == MouseButton::Left && !window->isMaximized()) {
@@ -446,6 +486,7 @@ void Application::handleMouseDown(i32 x, i32 y, MouseButton button) {
 
 void Application::handleMouseUp(i32 x, i32 y, MouseButton button) {
     AppState& state = getAppState();
+    state.lastInputTime = Platform::getMilliseconds();
 
     state.mouseDown = false;
     state.mousePosition = scaleMouseCoords(x, y);
@@ -558,6 +599,7 @@ void Application::handleMouseMove(i32 x, i32 y) {
 
 void Application::handleMouseWheel(i32 x, i32 y, i32 deltaY) {
     AppState& state = getAppState();
+    state.lastInputTime = Platform::getMilliseconds();
 
     // Block wheel events when a modal is open
     if (OverlayManager::instance().hasBlockingModal()) {
@@ -619,12 +661,12 @@ void Application::handleWindowResize(i32 width, i32 height) {
 }
 
 void Application::render() {
-#ifdef __EMSCRIPTEN__
-    // WASM: Use dirty region tracking for partial redraws
-    // This is a big win because JS canvas updates are expensive
+    // Use dirty region tracking for partial redraws when everything that
+    // changed was marked with markDirty(); present() then sends only those
+    // rects, which is a big win for JS canvas updates and X11 uploads alike
     AppState& state = getAppState();
 
-    if (state.dirtyRegion.fullRedraw || state.dirtyRegion.rects.empty()) {
+    if (!isPartialRedraw()) {
         // Full redraw - clear entire framebuffer and render everything
         framebuffer.clear(Config::COLOR_BACKGROUND);
 
@@ -634,9 +676,10 @@ void Application::render() {
 
         OverlayManager::instance().renderOverlays(framebuffer);
     } else {
-        // Partial redraw - only update dirty regions
-        // Use clipping to restrict rendering to dirty areas
-        for (const auto& dirtyRect : state.dirtyRegion.rects) {
+        // Partial redraw - only update dirty regions. The region's rects
+        // don't overlap, so no pixel is drawn twice; clipping restricts
+        // rendering to each in turn
+        for (const auto& dirtyRect : state.dirtyRegion.region) {
             // Clear only the dirty region
             framebuffer.clearRect(dirtyRect, Config::COLOR_BACKGROUND);
 
@@ -654,39 +697,21 @@ void Application::render() {
             framebuffer.popClip();
         }
     }
-#else
-    // Native: Always do full redraws - X11 blitting is fast and
-    // the overhead of dirty region tracking isn't worth it
-    framebuffer.clear(Config::COLOR_BACKGROUND);
-
-    if (rootWidget) {
-        rootWidget->render(framebuffer);
-    }
-
-    OverlayManager::instance().renderOverlays(framebuffer);
-#endif
 }
 
 void Application::present() {
     AppState& state = getAppState();
+    const u32* pixels = framebuffer.data();
 
-#ifdef __EMSCRIPTEN__
-    // WASM: Check if we can do a partial update
-    if (!state.dirtyRegion.fullRedraw && !state.dirtyRegion.rects.empty()) {
-        // Partial update - send only the dirty bounds
-        Recti bounds = state.dirtyRegion.bounds();
-        window->presentPartial(
-            reinterpret_cast<const u32*>(framebuffer.data()),
-            framebuffer.width, framebuffer.height,
-            bounds.x, bounds.y, bounds.w, bounds.h);
+    if (isPartialRedraw()) {
+        // Partial update - send each dirty rect, not their bounds
+        window->presentPartial(pixels, framebuffer.width, framebuffer.height,
+                               state.dirtyRegion.region.data(),
+                               state.dirtyRegion.region.rectCount());
     } else {
         // Full update
-        window->present(reinterpret_cast<const u32*>(framebuffer.data()),
-                        framebuffer.width, framebuffer.height);
+        window->present(pixels, framebuffer.width, framebuffer.height);
     }
-#else
-    window->present(framebuffer.data(), framebuffer.width, framebuffer.height);
-#endif
 }
 
 void Application::setTitle(const std::string& title) {
@@ -67,6 +67,13 @@ private:
     // Input state
     KeyMods currentMods;
 
+    // Main loop pacing
+    u64 lastPresentTime = 0;
+    u64 marchingAntsStep = 0;   // Step of the selection outline last drawn
+
+    // How long run() may sleep before the next frame is due (-1: until input)
+    i32 waitTimeout() const;
+
     // Create main window layout
     void createMainWindow();
     void loadDefaultFont();
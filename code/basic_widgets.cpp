@@ -490,6 +490,7 @@ void FontRenderer::renderToCanvas(TiledCanvas& canvas, const std::string& text,
             xpos += kern * scale;
         }
     }
+    canvas.touch();
 }
 
 Vec2 FontRenderer::measureTextWithFont(const std::string& text, f32 size, const std::string& fontName) {
@@ -1,3 +1,120 @@
 #include "blend.h"
+#include "pixel_format.h"
 
-// Blend functions are header-only for inlining, this file exists for unity build
+// Per-pixel blend functions are header-only for inlining; the span functions
+// live here so each instruction set can be compiled separately
+
+// SSE2 is part of every x86-64 CPU, so only AVX2 needs checking at runtime
+#if defined(__x86_64__) || defined(_M_X64)
+#define BLEND_SPAN_X86
+#endif
+
+#ifdef BLEND_SPAN_X86
+static_assert(PixelFormat::fromRGBA(0x11223344) == 0x44112233,
+              "blend_simd.inl's NativeTarget assumes 0xAARRGGBB framebuffers");
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace BlendSse2 {
+#include "blend_simd.inl"
+}
+
+// MSVC emits AVX2 intrinsics anywhere; GCC and Clang have to be told the
+// functions in between may use them
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#define BLEND_SIMD_AVX2
+namespace BlendAvx2 {
+#include "blend_simd.inl"
+}
+#undef BLEND_SIMD_AVX2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+static bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0;
+    if (!osSavesAvx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+namespace {
+struct SpanFunctions {
+    const BlendSse2::BlendSpanFunction* blend;
+    void (*alphaBlend)(u32*, const u32*, u32);
+    void (*alphaBlendNative)(u32*, const u32*, u32);
+    const char* name;
+};
+
+const SpanFunctions& spanFunctions() {
+    static const SpanFunctions functions = cpuHasAvx2()
+        ? SpanFunctions{BlendAvx2::blendFunctions, BlendAvx2::alphaBlendSpan,
+                        BlendAvx2::alphaBlendSpanNative, "avx2"}
+        : SpanFunctions{BlendSse2::blendFunctions, BlendSse2::alphaBlendSpan,
+                        BlendSse2::alphaBlendSpanNative, "sse2"};
+    return functions;
+}
+}
+
+namespace Blend {
+    void blendSpan(u32* dst, const u32* src, u32 count, BlendMode mode, f32 opacity) {
+        if (count == 0 || opacity <= 0.0f) return;
+        spanFunctions().blend[static_cast<u32>(mode)](dst, src, count, opacity);
+    }
+
+    void alphaBlendSpan(u32* dst, const u32* src, u32 count) {
+        if (count == 0) return;
+        spanFunctions().alphaBlend(dst, src, count);
+    }
+
+    void alphaBlendSpanNative(u32* dst, const u32* src, u32 count) {
+        if (count == 0) return;
+        spanFunctions().alphaBlendNative(dst, src, count);
+    }
+
+    const char* spanImplementation() { return spanFunctions().name; }
+}
+
+#else
+
+namespace Blend {
+    void blendSpan(u32* dst, const u32* src, u32 count, BlendMode mode, f32 opacity) {
+        if (opacity <= 0.0f) return;
+        for (u32 i = 0; i < count; ++i) dst[i] = blend(dst[i], src[i], mode, opacity);
+    }
+
+    void alphaBlendSpan(u32* dst, const u32* src, u32 count) {
+        for (u32 i = 0; i < count; ++i) dst[i] = alphaBlend(dst[i], src[i]);
+    }
+
+    void alphaBlendSpanNative(u32* dst, const u32* src, u32 count) {
+        for (u32 i = 0; i < count; ++i) {
+            dst[i] = PixelFormat::fromRGBA(alphaBlend(PixelFormat::toRGBA(dst[i]), src[i]));
+        }
+    }
+
+    const char* spanImplementation() { return "scalar"; }
+}
+
+#endif
@@ -143,6 +143,18 @@ namespace Blend {
         );
     }
 
+    // Span versions of blend() and alphaBlend(): dst[i] = blend(dst[i], src[i], ...)
+    // for count pixels, with the same results as the per-pixel functions. On x86
+    // they work 4 or 8 pixels at a time (SSE2 or AVX2, picked from the CPU).
+    void blendSpan(u32* dst, const u32* src, u32 count, BlendMode mode, f32 opacity);
+    void alphaBlendSpan(u32* dst, const u32* src, u32 count);
+    // alphaBlendSpan() onto pixels stored in PixelFormat's layout (Framebuffer
+    // rows); src stays 0xRRGGBBAA
+    void alphaBlendSpanNative(u32* dst, const u32* src, u32 count);
+
+    // Instruction set the span functions run on: "avx2", "sse2" or "scalar"
+    const char* spanImplementation();
+
     // Premultiplied alpha blend (more efficient for compositing)
     inline u32 blendPremultiplied(u32 dst, u32 src) {
         u8 sr, sg, sb, sa;
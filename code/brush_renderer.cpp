@@ -78,6 +78,7 @@ void stamp(TiledCanvas& canvas, const BrushStamp& brush,
     u8 cr, cg, cb, ca;
     Blend::unpack(color, cr, cg, cb, ca);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -101,7 +102,7 @@ void stamp(TiledCanvas& canvas, const BrushStamp& brush,
             u8 newAlpha = static_cast<u8>(std::min(255.0f, finalAlpha * 255.0f));
             u32 brushColor = Blend::pack(cr, cg, cb, newAlpha);
 
-            canvas.blendPixel(canvasX, canvasY, brushColor, mode, 1.0f);
+            writer.blendPixel(canvasX, canvasY, brushColor, mode, 1.0f);
         }
     }
 }
@@ -118,6 +119,7 @@ void stampToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
     u8 cr, cg, cb, ca;
     Blend::unpack(color, cr, cg, cb, ca);
 
+    TileWriter writer(buffer);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -137,11 +139,11 @@ void stampToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
 
             // Use MAX blending: only replace if new alpha is greater
             // This prevents overlapping dabs from building up opacity
-            u32 existing = buffer.getPixel(canvasX, canvasY);
+            u32 existing = writer.getPixel(canvasX, canvasY);
             u8 existingAlpha = existing & 0xFF;
             if (newAlpha > existingAlpha) {
                 u32 brushColor = Blend::pack(cr, cg, cb, newAlpha);
-                buffer.setPixel(canvasX, canvasY, brushColor);
+                writer.setPixel(canvasX, canvasY, brushColor);
             }
         }
     }
@@ -173,23 +175,7 @@ void strokeLineToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
 // Composite stroke buffer onto layer canvas with opacity
 void compositeStrokeToLayer(TiledCanvas& layer, const TiledCanvas& stroke,
                             f32 opacity, BlendMode mode) {
-    stroke.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
-        i32 baseX = tileX * static_cast<i32>(Config::TILE_SIZE);
-        i32 baseY = tileY * static_cast<i32>(Config::TILE_SIZE);
-
-        for (u32 ly = 0; ly < Config::TILE_SIZE; ++ly) {
-            i32 y = baseY + static_cast<i32>(ly);
-            for (u32 lx = 0; lx < Config::TILE_SIZE; ++lx) {
-                i32 x = baseX + static_cast<i32>(lx);
-                u32 strokePixel = tile.getPixel(lx, ly);
-                u8 strokeAlpha = strokePixel & 0xFF;
-
-                if (strokeAlpha > 0) {
-                    layer.blendPixel(x, y, strokePixel, mode, opacity);
-                }
-            }
-        }
-    });
+    layer.blendCanvas(stroke, mode, opacity);
 }
 
 // Erase stamp to buffer
@@ -199,6 +185,7 @@ void eraseStampToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
     i32 startX = static_cast<i32>(pos.x - brush.size / 2.0f);
     i32 startY = static_cast<i32>(pos.y - brush.size / 2.0f);
 
+    TileWriter writer(buffer);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -218,10 +205,10 @@ void eraseStampToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
             u32 eraseColor = Blend::pack(255, 255, 255, alpha);
 
             // Blend into buffer (max alpha)
-            u32 existing = buffer.getPixel(canvasX, canvasY);
+            u32 existing = writer.getPixel(canvasX, canvasY);
             u8 existingAlpha = existing & 0xFF;
             if (alpha > existingAlpha) {
-                buffer.setPixel(canvasX, canvasY, eraseColor);
+                writer.setPixel(canvasX, canvasY, eraseColor);
             }
         }
     }
@@ -252,6 +239,7 @@ void eraseLineToBuffer(TiledCanvas& buffer, const BrushStamp& brush,
 // Composite erase buffer to layer
 void compositeEraseBufferToLayer(TiledCanvas& layer, const TiledCanvas& eraseBuffer,
                                  f32 opacity) {
+    TileWriter writer(layer);
     eraseBuffer.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
         i32 baseX = tileX * static_cast<i32>(Config::TILE_SIZE);
         i32 baseY = tileY * static_cast<i32>(Config::TILE_SIZE);
@@ -264,7 +252,7 @@ void compositeEraseBufferToLayer(TiledCanvas& layer, const TiledCanvas& eraseBuf
                 u8 eraseAlpha = erasePixel & 0xFF;
 
                 if (eraseAlpha > 0) {
-                    u32 layerPixel = layer.getPixel(x, y);
+                    u32 layerPixel = writer.getPixel(x, y);
                     u8 lr, lg, lb, la;
                     Blend::unpack(layerPixel, lr, lg, lb, la);
 
@@ -273,7 +261,7 @@ void compositeEraseBufferToLayer(TiledCanvas& layer, const TiledCanvas& eraseBuf
                     f32 newAlpha = la * (1.0f - reduction);
                     la = static_cast<u8>(std::max(0.0f, newAlpha));
 
-                    layer.setPixel(x, y, Blend::pack(lr, lg, lb, la));
+                    writer.setPixel(x, y, Blend::pack(lr, lg, lb, la));
                 }
             }
         }
@@ -286,6 +274,7 @@ void erase(TiledCanvas& canvas, const BrushStamp& brush,
     i32 startX = static_cast<i32>(pos.x - brush.size / 2.0f);
     i32 startY = static_cast<i32>(pos.y - brush.size / 2.0f);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -304,7 +293,7 @@ void erase(TiledCanvas& canvas, const BrushStamp& brush,
                 brushAlpha *= selAlpha;
             }
 
-            u32 pixel = canvas.getPixel(canvasX, canvasY);
+            u32 pixel = writer.getPixel(canvasX, canvasY);
             u8 r, g, b, a;
             Blend::unpack(pixel, r, g, b, a);
 
@@ -312,7 +301,7 @@ void erase(TiledCanvas& canvas, const BrushStamp& brush,
             f32 newAlpha = a * (1.0f - reduction);
             a = static_cast<u8>(std::max(0.0f, newAlpha));
 
-            canvas.setPixel(canvasX, canvasY, Blend::pack(r, g, b, a));
+            writer.setPixel(canvasX, canvasY, Blend::pack(r, g, b, a));
         }
     }
 }
@@ -417,6 +406,7 @@ void pencilLine(TiledCanvas& canvas, i32 x0, i32 y0, i32 x1, i32 y1,
             y0 += sy;
         }
     }
+    canvas.touch();
 }
 
 void pencilEraseLine(TiledCanvas& canvas, i32 x0, i32 y0, i32 x1, i32 y1,
@@ -444,6 +434,7 @@ void pencilEraseLine(TiledCanvas& canvas, i32 x0, i32 y0, i32 x1, i32 y1,
             y0 += sy;
         }
     }
+    canvas.touch();
 }
 
 // Opacity-limited functions (for stroke opacity ceiling)
@@ -457,6 +448,7 @@ void stampWithOpacityLimit(TiledCanvas& canvas, const BrushStamp& brush,
     u8 cr, cg, cb, ca;
     Blend::unpack(color, cr, cg, cb, ca);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -490,7 +482,7 @@ void stampWithOpacityLimit(TiledCanvas& canvas, const BrushStamp& brush,
                 u8 newAlpha = static_cast<u8>(std::min(255.0f, applyAlpha * 255.0f));
                 u32 brushColor = Blend::pack(cr, cg, cb, newAlpha);
 
-                canvas.blendPixel(canvasX, canvasY, brushColor, mode, 1.0f);
+                writer.blendPixel(canvasX, canvasY, brushColor, mode, 1.0f);
                 currentAlpha += applyAlpha;
             }
         }
@@ -529,6 +521,7 @@ void eraseWithOpacityLimit(TiledCanvas& canvas, const BrushStamp& brush,
     i32 startX = static_cast<i32>(pos.x - brush.size / 2.0f);
     i32 startY = static_cast<i32>(pos.y - brush.size / 2.0f);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < brush.size; ++by) {
         i32 canvasY = startY + by;
         for (u32 bx = 0; bx < brush.size; ++bx) {
@@ -556,14 +549,14 @@ void eraseWithOpacityLimit(TiledCanvas& canvas, const BrushStamp& brush,
                 f32 remaining = strokeOpacity - currentAlpha;
                 f32 applyAlpha = std::min(dabAlpha, remaining);
 
-                u32 pixel = canvas.getPixel(canvasX, canvasY);
+                u32 pixel = writer.getPixel(canvasX, canvasY);
                 u8 r, g, b, a;
                 Blend::unpack(pixel, r, g, b, a);
 
                 f32 newAlpha = a * (1.0f - applyAlpha);
                 a = static_cast<u8>(std::max(0.0f, newAlpha));
 
-                canvas.setPixel(canvasX, canvasY, Blend::pack(r, g, b, a));
+                writer.setPixel(canvasX, canvasY, Blend::pack(r, g, b, a));
                 currentAlpha += applyAlpha;
             }
         }
@@ -654,6 +647,7 @@ void pencilLineWithOpacityLimit(TiledCanvas& canvas, i32 x0, i32 y0, i32 x1, i32
             y0 += sy;
         }
     }
+    canvas.touch();
 }
 
 void pencilEraseWithOpacityLimit(TiledCanvas& canvas, i32 x, i32 y,
@@ -714,6 +708,7 @@ void pencilEraseLineWithOpacityLimit(TiledCanvas& canvas, i32 x0, i32 y0, i32 x1
             y0 += sy;
         }
     }
+    canvas.touch();
 }
 
 // Custom brush tip functions
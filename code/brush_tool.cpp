@@ -103,6 +103,7 @@ void BrushTool::onMouseDown(Document& doc, const ToolEvent& e) {
         doc.captureOriginalTile(doc.activeLayerIndex, makeTileKey(tileX, tileY));
 
         BrushRenderer::pencilPixel(layer->canvas, px, py, strokeColor, effectiveFlow, sel, selTransform);
+        layer->canvas.touch();
         doc.notifyChanged(Rect(e.position.x - 1, e.position.y - 1, 3, 3));
     } else {
         // Create stroke buffer for this stroke
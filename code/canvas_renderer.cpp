@@ -0,0 +1,370 @@
+#include "canvas_renderer.h"
+#include "platform.h"
+#include <algorithm>
+#include <cmath>
+
+// Snapshot layer of the same kind as layer, reusing one from the previous
+// snapshot when it was made for the same live layer
+static std::unique_ptr<LayerBase> takeLayer(const LayerBase* layer,
+                                            std::vector<std::unique_ptr<LayerBase>>& previous,
+                                            const std::vector<const LayerBase*>& previousSources) {
+    for (size_t i = 0; i < previous.size(); ++i) {
+        const LayerBase* candidate = previous[i].get();
+        if (previousSources[i] == layer && candidate &&
+            candidate->isPixelLayer() == layer->isPixelLayer() &&
+            candidate->isTextLayer() == layer->isTextLayer()) {
+            return std::move(previous[i]);
+        }
+    }
+    if (layer->isPixelLayer()) return std::make_unique<PixelLayer>();
+    if (layer->isTextLayer()) return std::make_unique<TextLayer>();
+    return std::make_unique<AdjustmentLayer>();
+}
+
+// Share canvas's tiles, keeping its revision so content signatures match
+static void shareCanvas(TiledCanvas& dst, const TiledCanvas& src) {
+    dst = std::move(*src.clone());
+    dst.revision = src.revision;
+}
+
+void CanvasRenderer::takeSnapshot(const Document& doc) {
+    snapshot.width = doc.width;
+    snapshot.height = doc.height;
+
+    std::vector<std::unique_ptr<LayerBase>> previous = std::move(snapshot.layers);
+    std::vector<const LayerBase*> previousSources = std::move(snapshotSources);
+    snapshot.layers.clear();
+    snapshotSources.clear();
+
+    for (const auto& layer : doc.layers) {
+        std::unique_ptr<LayerBase> copy = takeLayer(layer.get(), previous, previousSources);
+        copy->transform = layer->transform;
+        copy->opacity = layer->opacity;
+        copy->visible = layer->visible;
+        copy->blend = layer->blend;
+
+        if (layer->isPixelLayer()) {
+            shareCanvas(static_cast<PixelLayer*>(copy.get())->canvas,
+                        static_cast<const PixelLayer*>(layer.get())->canvas);
+        } else if (layer->isTextLayer()) {
+            // Text is rasterized here so the render thread never needs the fonts
+            const TextLayer* text = static_cast<const TextLayer*>(layer.get());
+            TextLayer* textCopy = static_cast<TextLayer*>(copy.get());
+            text->ensureCacheValid();
+            shareCanvas(textCopy->rasterizedCache, text->rasterizedCache);
+            textCopy->cacheValid = true;
+        } else if (layer->isAdjustmentLayer()) {
+            const AdjustmentLayer* adj = static_cast<const AdjustmentLayer*>(layer.get());
+            AdjustmentLayer* adjCopy = static_cast<AdjustmentLayer*>(copy.get());
+            adjCopy->type = adj->type;
+            adjCopy->params = adj->params;
+        }
+
+        snapshot.layers.push_back(std::move(copy));
+        snapshotSources.push_back(layer.get());
+    }
+
+    auto snapshotLayer = [&](const LayerBase* layer) -> const PixelLayer* {
+        for (size_t i = 0; i < snapshotSources.size(); ++i) {
+            if (snapshotSources[i] == layer) return static_cast<const PixelLayer*>(snapshot.layers[i].get());
+        }
+        return nullptr;
+    };
+
+    snapshot.floatingContent = doc.floatingContent;
+    if (doc.floatingContent.active && doc.floatingContent.pixels) {
+        shareCanvas(floatingPixels, *doc.floatingContent.pixels);
+        snapshot.floatingContent.pixels = &floatingPixels;
+        snapshot.floatingContent.sourceLayer = snapshotLayer(doc.floatingContent.sourceLayer);
+    } else {
+        floatingPixels.clear();
+        snapshot.floatingContent.pixels = nullptr;
+    }
+
+    stroke = Compositor::findActiveStroke(doc);
+    if (stroke.buffer) {
+        shareCanvas(strokePixels, *stroke.buffer);
+        stroke.buffer = &strokePixels;
+        stroke.layer = snapshotLayer(stroke.layer);
+        if (!stroke.layer) stroke = Compositor::ActiveStroke();
+    } else {
+        strokePixels.clear();
+    }
+
+    // Drop cached tiles for the changes the live document reported
+    if (request.layersChanged) {
+        cache.invalidate();
+    }
+    if (!request.dirty.isEmpty()) {
+        cache.invalidateRect(request.dirty);
+        cache.contentSignature = CompositeCache::computeContentSignature(snapshot);
+    }
+    source = &doc;
+}
+
+void CanvasRenderer::drawPreview() {
+    const u32 factor = Config::VIEW_PREVIEW_FACTOR;
+    u32 w = (canvas.width + factor - 1) / factor;
+    u32 h = (canvas.height + factor - 1) / factor;
+    if (previewCanvas.width != w || previewCanvas.height != h) {
+        previewCanvas.resize(w, h);
+    }
+
+    previewCanvas.clear(Config::COLOR_BACKGROUND);
+    Compositor::compositeDocument(previewCanvas, snapshot, cache, stroke,
+                                  Rect(0, 0, static_cast<f32>(w), static_cast<f32>(h)),
+                                  request.zoom / factor, request.pan / static_cast<f32>(factor),
+                                  {Recti(0, 0, static_cast<i32>(w), static_cast<i32>(h))});
+    canvas.blitScaled(previewCanvas, 0, 0, factor);
+}
+
+void CanvasRenderer::draw(u64 deadline) {
+    const Document& doc = snapshot;
+    const i32 width = request.width;
+    const i32 height = request.height;
+    if (canvas.width != static_cast<u32>(width) || canvas.height != static_cast<u32>(height)) {
+        canvas.resize(static_cast<u32>(width), static_cast<u32>(height));
+        drawnValid = false;
+    }
+
+    DrawnState current;
+    current.source = source;
+    current.zoom = request.zoom;
+    current.pan = request.pan;
+    current.pixelGrid = request.pixelGrid;
+    current.signature = CompositeCache::computeSignature(doc);
+    current.contentSignature = CompositeCache::computeContentSignature(doc);
+
+    // Floating content changes the picture without going through the signatures
+    bool reusable = drawnValid && !request.layersChanged && !doc.floatingContent.active &&
+                    current.source == drawn.source &&
+                    current.zoom == drawn.zoom &&
+                    current.pixelGrid == drawn.pixelGrid &&
+                    current.signature == drawn.signature &&
+                    current.contentSignature == drawn.contentSignature;
+
+    // The pan may only have moved by whole pixels
+    f32 shiftX = current.pan.x - drawn.pan.x;
+    f32 shiftY = current.pan.y - drawn.pan.y;
+    if (shiftX != std::round(shiftX) || shiftY != std::round(shiftY) ||
+        std::abs(shiftX) >= width || std::abs(shiftY) >= height) {
+        reusable = false;
+    }
+    // A preview still being refined is redrawn rather than scrolled
+    if (refinementPending() && (shiftX != 0.0f || shiftY != 0.0f)) {
+        reusable = false;
+    }
+
+    const Recti bufferRect(0, 0, width, height);
+    std::vector<Recti> regions;
+    bool composited = false;
+    if (!reusable) {
+        // The preview only saves work when it reads a coarser level than the
+        // full view; zoomed in both come from the 1:1 cache
+        if (request.zoom / Config::VIEW_PREVIEW_FACTOR < Config::COMPOSITE_CACHE_MIN_ZOOM) {
+            drawPreview();
+            refineFrom = 0;
+            composited = true;
+        } else {
+            regions.push_back(bufferRect);
+            refineFrom = height;
+        }
+    } else {
+        i32 dx = static_cast<i32>(shiftX);
+        i32 dy = static_cast<i32>(shiftY);
+        if (dx != 0 || dy != 0) {
+            canvas.scroll(bufferRect, dx, dy);
+
+            // Rows that scrolled in, then the columns beside them
+            if (dy > 0) regions.push_back(Recti(0, 0, width, dy));
+            if (dy < 0) regions.push_back(Recti(0, height + dy, width, -dy));
+            i32 rowsY = std::max(dy, 0);
+            i32 rowsH = height - std::abs(dy);
+            if (dx > 0) regions.push_back(Recti(0, rowsY, dx, rowsH));
+            if (dx < 0) regions.push_back(Recti(width + dx, rowsY, -dx, rowsH));
+        }
+
+        // Edited document area, widened to whole screen pixels plus one for
+        // bilinear sampling at zooms below 1
+        const Rect& dirtyRect = request.dirty;
+        if (!dirtyRect.isEmpty()) {
+            f32 x0 = std::floor(dirtyRect.x * current.zoom + current.pan.x) - 1.0f;
+            f32 y0 = std::floor(dirtyRect.y * current.zoom + current.pan.y) - 1.0f;
+            f32 x1 = std::ceil((dirtyRect.x + dirtyRect.w) * current.zoom + current.pan.x) + 1.0f;
+            f32 y1 = std::ceil((dirtyRect.y + dirtyRect.h) * current.zoom + current.pan.y) + 1.0f;
+            Rect dirty = Rect(x0, y0, x1 - x0, y1 - y0).intersection(bufferRect.toRect());
+            if (!dirty.isEmpty()) regions.push_back(Recti(dirty));
+        }
+    }
+    // Both are consumed by the first slice of a request
+    request.dirty = Rect();
+    request.layersChanged = false;
+
+    if (!regions.empty()) {
+        for (const Recti& region : regions) {
+            canvas.clearRect(region, Config::COLOR_BACKGROUND);
+        }
+        Compositor::compositeDocument(canvas, doc, cache, stroke, bufferRect.toRect(),
+                                      current.zoom, current.pan, regions, current.pixelGrid);
+        composited = true;
+    }
+
+    // Replace the preview at full quality, band by band until the deadline.
+    // Requests made during an interaction skip this to keep previews coming.
+    if (refinementPending() && !request.interacting) {
+        do {
+            Recti band(0, refineFrom, width, std::min(Config::VIEW_REFINE_BAND, height - refineFrom));
+            canvas.clearRect(band, Config::COLOR_BACKGROUND);
+            Compositor::compositeDocument(canvas, doc, cache, stroke, bufferRect.toRect(),
+                                          current.zoom, current.pan, {band}, current.pixelGrid);
+            refineFrom += band.h;
+        } while (refinementPending() && !sliceOver(deadline));
+        composited = true;
+    }
+
+    // Compositing may have built caches that move the content signature
+    if (composited) {
+        current.contentSignature = CompositeCache::computeContentSignature(doc);
+    }
+    drawn = current;
+    drawnValid = true;
+}
+
+bool CanvasRenderer::sliceOver(u64 deadline) {
+#ifdef __EMSCRIPTEN__
+    Platform::updateFrameTime();  // getMilliseconds() is cached per frame
+    return Platform::getMilliseconds() >= deadline;
+#else
+    return interrupted || Platform::getMilliseconds() >= deadline;
+#endif
+}
+
+void CanvasRenderer::publish() {
+    if (back->width != canvas.width || back->height != canvas.height) {
+        back->resize(canvas.width, canvas.height);
+    }
+    std::copy(canvas.pixels.begin(), canvas.pixels.end(), back->pixels.begin());
+
+#ifndef __EMSCRIPTEN__
+    std::lock_guard<std::mutex> lock(mutex);
+#endif
+    std::swap(back, ready);
+    readyIsNew = true;
+    readyPartial = refinementPending();
+}
+
+const Framebuffer* CanvasRenderer::acquire() {
+#ifndef __EMSCRIPTEN__
+    std::lock_guard<std::mutex> lock(mutex);
+#endif
+    if (readyIsNew) {
+        std::swap(ready, front);
+        frontPartial = readyPartial;
+        readyIsNew = false;
+    }
+    return front->width > 0 ? front : nullptr;
+}
+
+#ifdef __EMSCRIPTEN__
+
+CanvasRenderer::CanvasRenderer() {}
+CanvasRenderer::~CanvasRenderer() {}
+
+bool CanvasRenderer::isBusy() const {
+    return false;
+}
+
+void CanvasRenderer::interrupt() {}
+
+void CanvasRenderer::submit(const Document& doc, const Request& newRequest) {
+    request = newRequest;
+    takeSnapshot(doc);
+    draw(Platform::getMilliseconds() + Config::VIEW_REFINE_BUDGET_MS);
+    publish();
+}
+
+void CanvasRenderer::reset() {
+    snapshot.layers.clear();
+    snapshotSources.clear();
+    cache.invalidate();
+    floatingPixels.clear();
+    strokePixels.clear();
+    stroke = Compositor::ActiveStroke();
+    source = nullptr;
+    drawnValid = false;
+}
+
+#else
+
+CanvasRenderer::CanvasRenderer() {
+    thread = std::thread([this]() { threadLoop(); });
+}
+
+CanvasRenderer::~CanvasRenderer() {
+    interrupted = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    thread.join();
+}
+
+bool CanvasRenderer::isBusy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return busy;
+}
+
+void CanvasRenderer::interrupt() {
+    interrupted = true;
+}
+
+void CanvasRenderer::submit(const Document& doc, const Request& newRequest) {
+    request = newRequest;
+    takeSnapshot(doc);
+    interrupted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = true;
+    }
+    wakeCondition.notify_all();
+}
+
+void CanvasRenderer::reset() {
+    interrupted = true;
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCondition.wait(lock, [this]() { return !busy; });
+
+    snapshot.layers.clear();
+    snapshotSources.clear();
+    cache.invalidate();
+    floatingPixels.clear();
+    strokePixels.clear();
+    stroke = Compositor::ActiveStroke();
+    source = nullptr;
+    drawnValid = false;
+}
+
+void CanvasRenderer::threadLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [this]() { return stopping || busy; });
+            if (stopping) return;
+        }
+
+        // Publish every budget slice so a long refinement shows progress
+        do {
+            draw(Platform::getMilliseconds() + Config::VIEW_REFINE_BUDGET_MS);
+            publish();
+        } while (refinementPending() && !request.interacting && !interrupted);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        idleCondition.notify_all();
+    }
+}
+
+#endif
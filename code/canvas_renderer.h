@@ -0,0 +1,137 @@
+#ifndef _H_CANVAS_RENDERER_
+#define _H_CANVAS_RENDERER_
+
+#include "types.h"
+#include "primitives.h"
+#include "framebuffer.h"
+#include "document.h"
+#include "compositor.h"
+#include <vector>
+#include <memory>
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#endif
+
+// Composites a document view on a thread of its own, so slow frames never
+// hold up event handling or the tools.
+//
+// submit() takes a snapshot of the document on the UI thread: a private
+// Document whose layers share their tiles copy-on-write with the real ones,
+// so it costs a handle per tile and later edits copy the tiles they touch
+// instead of changing what the render thread reads. Snapshot layers are
+// kept from one request to the next, along with the snapshot's flattened
+// cache and mip levels, so only what changed is composited again.
+//
+// Finished frames go through three buffers: the render thread draws into
+// back and swaps it with ready, and acquire() swaps ready with front, which
+// only the UI thread reads. A frame the UI never picked up is replaced by
+// the next one, so the latest frame always wins.
+//
+// The drawing itself keeps the last frame between requests: whole-pixel pans
+// are scrolled, edited areas recomposited, and below 200% full redraws start
+// from a preview at 1/Config::VIEW_PREVIEW_FACTOR density that is refined in
+// bands unless the request was made during an interaction.
+//
+// WASM builds have no threads and draw one Config::VIEW_REFINE_BUDGET_MS
+// slice inside submit().
+class CanvasRenderer {
+public:
+    struct Request {
+        f32 zoom = 1.0f;
+        Vec2 pan;
+        i32 width = 0;
+        i32 height = 0;
+        bool pixelGrid = false;
+        bool interacting = false;     // Input in flight: show previews, don't refine
+        Rect dirty;                   // Document area edited since the last request
+        bool layersChanged = false;   // Layers added, removed, moved or replaced
+    };
+
+    CanvasRenderer();
+    ~CanvasRenderer();
+
+    CanvasRenderer(const CanvasRenderer&) = delete;
+    CanvasRenderer& operator=(const CanvasRenderer&) = delete;
+
+    // True while a request is being drawn; submit() has to wait for this
+    bool isBusy() const;
+
+    // Ask the render thread to publish what it has and take no more bands
+    void interrupt();
+
+    // Snapshot doc and start drawing. UI thread only, never while busy.
+    void submit(const Document& doc, const Request& request);
+
+    // Newest published frame (nullptr before the first one)
+    const Framebuffer* acquire();
+
+    // The frame from the last acquire() still shows part of a preview
+    bool needsRefinement() const { return frontPartial; }
+
+    // Drop the snapshot and the tiles it holds, waiting for a frame in progress
+    void reset();
+
+private:
+    // What the buffer in canvas shows
+    struct DrawnState {
+        const Document* source = nullptr;
+        f32 zoom = 0.0f;
+        Vec2 pan;
+        bool pixelGrid = false;
+        u64 signature = 0;
+        u64 contentSignature = 0;
+    };
+
+    // Snapshot (written by submit() while idle, read by the render thread)
+    Document snapshot;
+    CompositeCache cache;                            // Flattened snapshot, kept across requests
+    std::vector<const LayerBase*> snapshotSources;   // Live layer behind each snapshot layer
+    TiledCanvas floatingPixels;
+    TiledCanvas strokePixels;
+    Compositor::ActiveStroke stroke;
+    const Document* source = nullptr;
+    Request request;
+
+    // Render thread state
+    Framebuffer canvas;
+    Framebuffer previewCanvas;
+    DrawnState drawn;
+    bool drawnValid = false;
+    i32 refineFrom = 0;   // canvas rows from here down still show the preview
+
+    // Published frames (pointers swapped under the mutex)
+    Framebuffer frames[3];
+    Framebuffer* back = &frames[0];
+    Framebuffer* ready = &frames[1];
+    Framebuffer* front = &frames[2];
+    bool readyIsNew = false;
+    bool readyPartial = false;
+    bool frontPartial = false;
+
+    void takeSnapshot(const Document& doc);
+    // Bring canvas up to date, refining until deadline (Platform::getMilliseconds)
+    void draw(u64 deadline);
+    void drawPreview();
+    // Time to stop refining: the deadline passed or a newer request is waiting
+    bool sliceOver(u64 deadline);
+    void publish();
+    bool refinementPending() const { return refineFrom < static_cast<i32>(canvas.height); }
+
+#ifndef __EMSCRIPTEN__
+    void threadLoop();
+
+    std::thread thread;
+    mutable std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable idleCondition;
+    bool busy = false;
+    bool stopping = false;
+    std::atomic<bool> interrupted{false};
+#endif
+};
+
+#endif
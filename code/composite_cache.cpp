@@ -0,0 +1,192 @@
+#include "composite_cache.h"
+#include "document.h"
+#include <cmath>
+#include <variant>
+#include <vector>
+#include <algorithm>
+
+// FNV-1a hash used to detect layer stack changes
+struct StackHasher {
+    u64 hash = 14695981039346656037ull;
+
+    void addBytes(const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    template<typename T>
+    void add(const T& value) { addBytes(&value, sizeof(T)); }
+};
+
+u64 CompositeCache::computeSignature(const Document& doc) {
+    StackHasher hasher;
+    hasher.add(doc.width);
+    hasher.add(doc.height);
+
+    for (const auto& layer : doc.layers) {
+        hasher.add(layer.get());
+        hasher.add(layer->visible);
+        if (!layer->visible) continue;
+
+        hasher.add(layer->blend);
+        hasher.add(layer->opacity);
+        hasher.add(layer->transform.position);
+        hasher.add(layer->transform.scale);
+        hasher.add(layer->transform.rotation);
+        hasher.add(layer->transform.pivot);
+
+        if (layer->isPixelLayer()) {
+            const TiledCanvas& canvas = static_cast<const PixelLayer*>(layer.get())->canvas;
+            hasher.add(canvas.width);
+            hasher.add(canvas.height);
+        } else if (layer->isAdjustmentLayer()) {
+            const AdjustmentLayer* adj = static_cast<const AdjustmentLayer*>(layer.get());
+            hasher.add(adj->type);
+            std::visit([&](const auto& params) { hasher.add(params); }, adj->params);
+        }
+    }
+
+    return hasher.hash;
+}
+
+u64 CompositeCache::computeContentSignature(const Document& doc, const LayerBase* exclude) {
+    StackHasher hasher;
+    for (const auto& layer : doc.layers) {
+        if (!layer->visible || layer.get() == exclude) continue;
+        if (layer->isPixelLayer()) {
+            hasher.add(static_cast<const PixelLayer*>(layer.get())->canvas.revision);
+        } else if (layer->isTextLayer()) {
+            hasher.add(static_cast<const TextLayer*>(layer.get())->rasterizedCache.revision);
+        }
+    }
+    return hasher.hash;
+}
+
+void CompositeCache::invalidate() {
+    canvas.clear();
+    validTiles.clear();
+    strokePlanes.reset();
+    mips.clear();
+    reduced.reset();
+}
+
+void CompositeCache::setBounds(u32 width, u32 height) {
+    if (canvas.width == width && canvas.height == height) return;
+    canvas.resize(width, height);
+    strokePlanes.below.resize(width, height);
+    strokePlanes.above.resize(width, height);
+}
+
+void CompositeCache::setReducedLevel(u32 level, u32 docWidth, u32 docHeight) {
+    u32 scale = 1u << level;
+    u32 width = (docWidth + scale - 1) / scale;
+    u32 height = (docHeight + scale - 1) / scale;
+    if (reduced.level == level && reduced.canvas.width == width && reduced.canvas.height == height) return;
+
+    reduced.reset();
+    reduced.level = level;
+    reduced.canvas.resize(width, height);
+}
+
+// Drop cached tiles overlapping a pixel rect [x0, x1) x [y0, y1)
+static void dropTiles(TiledCanvas& canvas, std::unordered_set<u64>& validTiles,
+                      i32 x0, i32 y0, i32 x1, i32 y1) {
+    i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    i32 tx0 = floorDiv(x0, tileSize);
+    i32 ty0 = floorDiv(y0, tileSize);
+    i32 tx1 = floorDiv(x1 - 1, tileSize);
+    i32 ty1 = floorDiv(y1 - 1, tileSize);
+
+    // Large rects touch more tiles than are cached - walk the cache instead
+    i64 rectTiles = static_cast<i64>(tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    if (rectTiles > static_cast<i64>(validTiles.size())) {
+        for (auto it = validTiles.begin(); it != validTiles.end(); ) {
+            i32 tx, ty;
+            extractTileCoords(*it, tx, ty);
+            if (tx >= tx0 && tx <= tx1 && ty >= ty0 && ty <= ty1) {
+                canvas.removeTile(tx, ty);
+                it = validTiles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return;
+    }
+
+    for (i32 ty = ty0; ty <= ty1; ++ty) {
+        for (i32 tx = tx0; tx <= tx1; ++tx) {
+            u64 key = makeTileKey(tx, ty);
+            if (validTiles.erase(key)) {
+                canvas.removeTile(tx, ty);
+            }
+        }
+    }
+}
+
+// Drop cached tiles outside a tile rect, farthest from it first, until at most
+// maxTiles are left. The second canvas (if any) shares the same tile keys.
+static void evictTiles(std::unordered_set<u64>& validTiles, const Recti& keepTiles, size_t maxTiles,
+                       TiledCanvas& canvas, TiledCanvas* second = nullptr) {
+    if (validTiles.size() <= maxTiles) return;
+
+    // Chebyshev distance in tiles from the kept rect
+    std::vector<std::pair<i32, u64>> outside;
+    for (u64 key : validTiles) {
+        i32 tx, ty;
+        extractTileCoords(key, tx, ty);
+        i32 dx = std::max(keepTiles.x - tx, tx - (keepTiles.x + keepTiles.w - 1));
+        i32 dy = std::max(keepTiles.y - ty, ty - (keepTiles.y + keepTiles.h - 1));
+        i32 distance = std::max(dx, dy);
+        if (distance > 0) outside.emplace_back(distance, key);
+    }
+
+    size_t excess = std::min(validTiles.size() - maxTiles, outside.size());
+    std::partial_sort(outside.begin(), outside.begin() + excess, outside.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (size_t i = 0; i < excess; ++i) {
+        i32 tx, ty;
+        extractTileCoords(outside[i].second, tx, ty);
+        validTiles.erase(outside[i].second);
+        canvas.removeTile(tx, ty);
+        if (second) second->removeTile(tx, ty);
+    }
+}
+
+void StrokePlanes::evictOutside(const Recti& keepTiles, size_t maxTiles) {
+    evictTiles(validTiles, keepTiles, maxTiles, below, &above);
+}
+
+void ReducedCache::evictOutside(const Recti& keepTiles, size_t maxTiles) {
+    evictTiles(validTiles, keepTiles, maxTiles, canvas);
+}
+
+void CompositeCache::evictOutside(const Recti& keepTiles, size_t maxTiles) {
+    evictTiles(validTiles, keepTiles, maxTiles, canvas);
+}
+
+void CompositeCache::invalidateRect(const Rect& docRect) {
+    if (docRect.isEmpty()) return;
+
+    // Pad by one pixel so bilinear-sampled (transformed) layers that bleed
+    // across the rect edge are refreshed as well
+    i32 x0 = static_cast<i32>(std::floor(docRect.x)) - 1;
+    i32 y0 = static_cast<i32>(std::floor(docRect.y)) - 1;
+    i32 x1 = static_cast<i32>(std::ceil(docRect.x + docRect.w)) + 1;
+    i32 y1 = static_cast<i32>(std::ceil(docRect.y + docRect.h)) + 1;
+
+    if (!validTiles.empty()) {
+        dropTiles(canvas, validTiles, x0, y0, x1, y1);
+    }
+
+    // Same area on the reduced cache, plus a pixel for transformed layers
+    // sampled bilinearly at that scale
+    if (!reduced.validTiles.empty()) {
+        i32 scale = 1 << reduced.level;
+        dropTiles(reduced.canvas, reduced.validTiles,
+                  floorDiv(x0, scale) - 1, floorDiv(y0, scale) - 1,
+                  floorDiv(x1 - 1, scale) + 2, floorDiv(y1 - 1, scale) + 2);
+    }
+}
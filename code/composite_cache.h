@@ -0,0 +1,108 @@
+#ifndef _H_COMPOSITE_CACHE_
+#define _H_COMPOSITE_CACHE_
+
+#include "types.h"
+#include "primitives.h"
+#include "tiled_canvas.h"
+#include "mip_pyramid.h"
+#include <unordered_set>
+
+class Document;
+
+class LayerBase;
+
+// Flattened planes around the layer being painted, kept for the duration of a
+// Brush/Eraser stroke so each frame only re-blends the stroke layer itself
+struct StrokePlanes {
+    const LayerBase* layer = nullptr;     // Layer being painted (nullptr = no planes)
+    u64 signature = 0;                    // Layer stack signature the planes were built for
+    u64 contentSignature = 0;             // Pixel revisions of every other layer
+    bool aboveCached = false;             // Layers above only use Normal blending
+    TiledCanvas below;                    // All layers under the stroke layer
+    TiledCanvas above;                    // All layers over the stroke layer (if aboveCached)
+    std::unordered_set<u64> validTiles;   // Tiles present in both planes
+
+    void reset() {
+        layer = nullptr;
+        aboveCached = false;
+        below.clear();
+        above.clear();
+        validTiles.clear();
+    }
+
+    // Drop tiles outside keepTiles (tile coordinates), farthest first, until
+    // at most maxTiles remain
+    void evictOutside(const Recti& keepTiles, size_t maxTiles);
+};
+
+// Flattened layer stack at 1/2^level scale for views zoomed out below
+// COMPOSITE_CACHE_MIN_ZOOM, built from the layers' mip levels. Only the level
+// matching the current zoom is kept.
+struct ReducedCache {
+    u32 level = 0;                        // 0 = unused
+    TiledCanvas canvas;
+    std::unordered_set<u64> validTiles;
+    MipPyramid mips;                      // Levels of canvas, for trilinear sampling
+    MipPyramid strokeMips;                // Levels of the live stroke buffer
+
+    void reset() {
+        canvas.clear();
+        validTiles.clear();
+        mips.clear();
+        strokeMips.clear();
+    }
+
+    // Drop tiles outside keepTiles (level tile coordinates), farthest first,
+    // until at most maxTiles remain
+    void evictOutside(const Recti& keepTiles, size_t maxTiles);
+};
+
+// Flattened result of a document's layer stack at 1:1 document resolution.
+// Tiles are filled lazily by the compositor and dropped when the document
+// reports changes in their area, so pan/zoom and UI-only redraws only have
+// to resample this canvas instead of re-blending every layer.
+struct CompositeCache {
+    TiledCanvas canvas;                  // Flattened pixels (transparent tiles are not stored)
+    std::unordered_set<u64> validTiles;  // Tile keys whose contents are up to date
+    u64 signature = 0;                   // Hash of the layer stack the tiles were built from
+    u64 contentSignature = 0;            // Hash of layer canvas revisions covered by invalidations
+    StrokePlanes strokePlanes;           // Only populated while a stroke is active
+    MipPyramid mips;                     // Levels of canvas for zooms below 1
+    ReducedCache reduced;                // Used instead below COMPOSITE_CACHE_MIN_ZOOM
+
+    bool isTileValid(i32 tx, i32 ty) const {
+        return validTiles.count(makeTileKey(tx, ty)) != 0;
+    }
+
+    // Drop every cached tile
+    void invalidate();
+
+    // Drop tiles overlapping a rectangle in document coordinates
+    void invalidateRect(const Rect& docRect);
+
+    // Drop tiles outside keepTiles (tile coordinates), farthest first, until at
+    // most maxTiles remain. Tiles inside keepTiles are never dropped, so a view
+    // that needs more than maxTiles keeps all of them.
+    void evictOutside(const Recti& keepTiles, size_t maxTiles);
+
+    // Size the cache and plane canvases to the document so their tiles use the
+    // dense part of the tile index
+    void setBounds(u32 width, u32 height);
+
+    // Switch the reduced cache to another level, dropping its tiles
+    void setReducedLevel(u32 level, u32 docWidth, u32 docHeight);
+
+    size_t getMemoryUsage() const { return canvas.getMemoryUsage(); }
+
+    // Hash of everything that affects flattened pixels but is not reported through
+    // Document::notifyChanged: layer order, visibility, blend, opacity, transforms
+    // and adjustment parameters
+    static u64 computeSignature(const Document& doc);
+
+    // Hash of the pixel revisions of every visible layer (optionally skipping one).
+    // Edits that were reported through notifyChanged are folded in there; anything
+    // else shows up as a mismatch and drops the whole cache.
+    static u64 computeContentSignature(const Document& doc, const LayerBase* exclude = nullptr);
+};
+
+#endif
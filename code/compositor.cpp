@@ -1,82 +1,650 @@
 #include "compositor.h"
 #include "sampler.h"
 #include "selection.h"
-#include "platform.h"
 #include "brush_tool.h"
 #include "eraser_tool.h"
+#include "thread_pool.h"
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
 
 namespace Compositor {
 
 // Pre-computed layer data to avoid per-pixel virtual calls and matrix inversions
 struct LayerRenderData {
     enum class Type { Pixel, Text, Adjustment };
-    Type type;
+    Type type = Type::Pixel;
     BlendMode blend;
     f32 opacity;
 
     // Transform data (pre-computed)
-    bool hasTransform;
+    bool hasTransform = false;
     Matrix3x2 invMatrix;
+    Recti sourceBounds;  // Tile bounds of the sampled canvas, for transformed layers
     Vec2 position;  // For position-only layers
 
     // Type-specific pointers
     const TiledCanvas* canvas = nullptr;         // For pixel layers
-    TiledCanvas* textCache = nullptr;            // For text layers (non-const for ensureCacheValid)
-    const AdjustmentLayer* adjustment = nullptr; // For adjustment layers
+    const TiledCanvas* textCache = nullptr;      // For text layers
+    const AdjustmentLut* adjustment = nullptr;   // For adjustment layers
     u32 canvasWidth = 0;
     u32 canvasHeight = 0;
 
     // Stroke overlay (only for the layer being painted)
-    TiledCanvas* strokeBuffer = nullptr;
+    const LayerBase* layer = nullptr;
+    bool isStrokeLayer = false;
+    const TiledCanvas* strokeBuffer = nullptr;
     f32 strokeOpacity = 1.0f;
     bool isEraserStroke = false;
+
+    // Row loops specialised for this layer's type, transform and stroke,
+    // picked once per frame by selectRowFunctions.
+    // sampleRow: layer pixels under document pixels (docX.., docY), count <= TILE_SIZE
+    void (*sampleRow)(const LayerRenderData& data, i32 docX, i32 docY, u32 count, u32* out) = nullptr;
+    // applyStroke: paint or erase the live stroke into a row of layer pixels
+    void (*applyStroke)(const LayerRenderData& data, u32* pixels, const u32* stroke, u32 count) = nullptr;
 };
 
+// Apply a row of the live stroke buffer to layer pixels
+template<bool Eraser>
+static void applyStrokeRow(const LayerRenderData& data, u32* pixels, const u32* stroke, u32 count) {
+    if constexpr (Eraser) {
+        for (u32 i = 0; i < count; ++i) {
+            u8 eraseAmount = stroke[i] & 0xFF;
+            if (eraseAmount == 0) continue;
+            f32 eraseFactor = (eraseAmount / 255.0f) * data.strokeOpacity;
+            u8 r, g, b, a;
+            Blend::unpack(pixels[i], r, g, b, a);
+            a = static_cast<u8>(a * (1.0f - eraseFactor));
+            pixels[i] = Blend::pack(r, g, b, a);
+        }
+    } else {
+        Blend::blendSpan(pixels, stroke, count, BlendMode::Normal, data.strokeOpacity);
+    }
+}
+
+// Layer pixels for a run of document pixels in one row, for layers that can't
+// be read straight from their tiles: transformed layers are sampled
+// bilinearly, layers at fractional positions take the nearest pixel
+template<LayerRenderData::Type T, bool Transformed, bool Stroke>
+static void sampleLayerRow(const LayerRenderData& data, i32 docX, i32 docY, u32 count, u32* out) {
+    constexpr bool isText = T == LayerRenderData::Type::Text;
+    const TiledCanvas& source = isText ? *data.textCache : *data.canvas;
+    TileReader reader(source);
+    TileReader strokeReader(Stroke ? *data.strokeBuffer : source);
+    u32 stroke[Config::TILE_SIZE];
+    const f32 y = static_cast<f32>(docY);
+
+    // Transformed layers without a stroke go through the row sampler in one call
+    AffineSampler affine(source, data.invMatrix, data.sourceBounds);
+    if constexpr (Transformed && !Stroke) {
+        affine.sampleRow(static_cast<f32>(docX), y, count, out);
+        return;
+    }
+    Vec2 origin = affine.start(static_cast<f32>(docX), y);
+    Vec2 delta = affine.step();
+
+    for (u32 i = 0; i < count; ++i) {
+        f32 x = static_cast<f32>(docX + static_cast<i32>(i));
+        f32 layerX, layerY;
+        if constexpr (Transformed) {
+            layerX = origin.x + static_cast<f32>(i) * delta.x;
+            layerY = origin.y + static_cast<f32>(i) * delta.y;
+            out[i] = affine.sample(layerX, layerY);
+        } else {
+            layerX = x - data.position.x;
+            layerY = y - data.position.y;
+            if constexpr (isText) {
+                // Text layers only cover their own canvas
+                i32 ix = static_cast<i32>(layerX);
+                i32 iy = static_cast<i32>(layerY);
+                bool inside = ix >= 0 && iy >= 0 && ix < static_cast<i32>(data.canvasWidth) &&
+                              iy < static_cast<i32>(data.canvasHeight);
+                out[i] = inside ? reader.getPixel(ix, iy) : 0;
+            } else {
+                out[i] = reader.getPixel(static_cast<i32>(std::floor(layerX)),
+                                         static_cast<i32>(std::floor(layerY)));
+            }
+        }
+
+        if constexpr (Stroke) {
+            stroke[i] = strokeReader.getPixel(static_cast<i32>(std::floor(layerX)),
+                                              static_cast<i32>(std::floor(layerY)));
+        }
+    }
+
+    if constexpr (Stroke) data.applyStroke(data, out, stroke, count);
+}
+
+static void selectRowFunctions(LayerRenderData& data) {
+    using Type = LayerRenderData::Type;
+    data.applyStroke = data.isEraserStroke ? applyStrokeRow<true> : applyStrokeRow<false>;
+    if (data.type == Type::Text) {
+        data.sampleRow = data.hasTransform ? sampleLayerRow<Type::Text, true, false>
+                                           : sampleLayerRow<Type::Text, false, false>;
+    } else if (data.type == Type::Pixel) {
+        if (data.strokeBuffer) {
+            data.sampleRow = data.hasTransform ? sampleLayerRow<Type::Pixel, true, true>
+                                               : sampleLayerRow<Type::Pixel, false, true>;
+        } else {
+            data.sampleRow = data.hasTransform ? sampleLayerRow<Type::Pixel, true, false>
+                                               : sampleLayerRow<Type::Pixel, false, false>;
+        }
+    }
+}
+
+// Tiles covering a pixel rect, as a rect in tile coordinates
+static Recti tileRect(const Recti& rect) {
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    i32 tx0 = floorDiv(rect.x, tileSize);
+    i32 ty0 = floorDiv(rect.y, tileSize);
+    i32 tx1 = floorDiv(rect.x + rect.w - 1, tileSize);
+    i32 ty1 = floorDiv(rect.y + rect.h - 1, tileSize);
+    return Recti(tx0, ty0, tx1 - tx0 + 1, ty1 - ty0 + 1);
+}
+
+// Pixel rect around a float area, padded by the footprint of a trilinear
+// sample at the given mip level
+static Recti mipSampleRect(f32 x0, f32 y0, f32 x1, f32 y1, u32 level) {
+    i32 pad = 2 << level;
+    i32 ix0 = static_cast<i32>(std::floor(x0)) - pad;
+    i32 iy0 = static_cast<i32>(std::floor(y0)) - pad;
+    i32 ix1 = static_cast<i32>(std::ceil(x1)) + pad;
+    i32 iy1 = static_cast<i32>(std::ceil(y1)) + pad;
+    return Recti(ix0, iy0, ix1 - ix0, iy1 - iy0);
+}
+
+// Source pixels of a layer behind a document rect
+static Recti layerSourceRect(const LayerRenderData& data, const Rect& docArea, u32 level) {
+    f32 x0, y0, x1, y1;
+    if (data.hasTransform) {
+        Vec2 corners[4] = {
+            data.invMatrix.transform(Vec2(docArea.x, docArea.y)),
+            data.invMatrix.transform(Vec2(docArea.x + docArea.w, docArea.y)),
+            data.invMatrix.transform(Vec2(docArea.x, docArea.y + docArea.h)),
+            data.invMatrix.transform(Vec2(docArea.x + docArea.w, docArea.y + docArea.h))
+        };
+        x0 = x1 = corners[0].x;
+        y0 = y1 = corners[0].y;
+        for (const Vec2& c : corners) {
+            x0 = std::min(x0, c.x);
+            y0 = std::min(y0, c.y);
+            x1 = std::max(x1, c.x);
+            y1 = std::max(y1, c.y);
+        }
+    } else {
+        x0 = docArea.x - data.position.x;
+        y0 = docArea.y - data.position.y;
+        x1 = x0 + docArea.w;
+        y1 = y0 + docArea.h;
+    }
+    return mipSampleRect(x0, y0, x1, y1, level);
+}
+
+// Store a tile in a cache canvas, leaving fully transparent tiles out.
+// Solid tiles are swapped for the shared tile of their color.
+static void storeTile(TiledCanvas& canvas, u64 key, std::unique_ptr<Tile> tile) {
+    if (tile && !tile->isEmpty()) {
+        i32 tileX, tileY;
+        extractTileCoords(key, tileX, tileY);
+        if (tile->solid) {
+            canvas.setTile(tileX, tileY, TiledCanvas::solidTile(tile->solidColor));
+        } else {
+            canvas.setTile(tileX, tileY, std::move(tile));
+        }
+    }
+}
+
+// A tile-sized block of composited pixels. While everything blended into it so
+// far was flat (solid tiles, missing tiles, adjustments of a flat color) the
+// block only tracks that one color, and the pixels are written when a layer
+// with real detail arrives or when the block is finished.
+struct TileBlock {
+    u32* pixels;
+    bool flat;              // Every pixel is color
+    bool pending = false;   // pixels[] does not hold color yet
+    u32 color;
+
+    TileBlock(u32* p, bool isFlat, u32 flatColor) : pixels(p), flat(isFlat), color(flatColor) {}
+
+    // Switch to per-pixel work
+    void expand() {
+        finish();
+        flat = false;
+    }
+
+    void finish() {
+        if (pending) {
+            std::fill(pixels, pixels + Config::TILE_SIZE * Config::TILE_SIZE, color);
+            pending = false;
+        }
+    }
+};
+
+// Whether the layer hides everything under the block at (baseX, baseY): a
+// Normal, fully opaque pixel layer whose tiles there are all opaque. Blending
+// such a layer gives its own pixels whatever was under them, so compositing
+// can start from it.
+static bool coversBlock(const LayerRenderData& data, i32 baseX, i32 baseY) {
+    if (data.type != LayerRenderData::Type::Pixel || data.blend != BlendMode::Normal ||
+        data.opacity < 1.0f || data.hasTransform || data.strokeBuffer ||
+        data.position.x != std::floor(data.position.x) ||
+        data.position.y != std::floor(data.position.y)) {
+        return false;
+    }
+
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    i32 offsetX = baseX - static_cast<i32>(data.position.x);
+    i32 offsetY = baseY - static_cast<i32>(data.position.y);
+    i32 startX = floorDiv(offsetX, tileSize);
+    i32 startY = floorDiv(offsetY, tileSize);
+    i32 endX = floorDiv(offsetX + tileSize - 1, tileSize);
+    i32 endY = floorDiv(offsetY + tileSize - 1, tileSize);
+    for (i32 tileY = startY; tileY <= endY; ++tileY) {
+        for (i32 tileX = startX; tileX <= endX; ++tileX) {
+            const Tile* tile = data.canvas->getTile(tileX, tileY);
+            if (!tile || tile->getCoverage() != TileCoverage::Opaque) return false;
+        }
+    }
+    return true;
+}
+
+// Composite a run of the layer stack over one tile-sized block of pixels at 1:1
+// document resolution, one layer at a time. Untransformed layers at whole-pixel
+// positions are read a tile row span at a time; anything else is sampled per pixel.
+// Layers whose tile lines up with the block and is solid blend as one color.
+// Layers hidden under an opaque one are not blended at all.
+static void compositeTileRun(const LayerRenderData* begin, const LayerRenderData* end,
+                             i32 baseX, i32 baseY, TileBlock& block) {
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    u32* pixels = block.pixels;
+
+    // Skip everything under the topmost layer that covers the block
+    for (const LayerRenderData* it = end; it != begin; ) {
+        --it;
+        if (coversBlock(*it, baseX, baseY)) {
+            begin = it;
+            break;
+        }
+    }
+
+    for (const LayerRenderData* it = begin; it != end; ++it) {
+        const LayerRenderData& data = *it;
+        if (data.type == LayerRenderData::Type::Adjustment) {
+            if (block.flat) {
+                block.color = data.adjustment->apply(block.color);
+                block.pending = true;
+                continue;
+            }
+            data.adjustment->applyRow(pixels, Config::TILE_SIZE * Config::TILE_SIZE);
+            continue;
+        }
+
+        bool spanPath = !data.hasTransform &&
+                        data.position.x == std::floor(data.position.x) &&
+                        data.position.y == std::floor(data.position.y);
+
+        // Pixel layer whose tile grid lines up with this block: a missing tile
+        // adds nothing and a solid one is a single color
+        if (spanPath && data.type == LayerRenderData::Type::Pixel) {
+            i32 offsetX = baseX - static_cast<i32>(data.position.x);
+            i32 offsetY = baseY - static_cast<i32>(data.position.y);
+            if (floorMod(offsetX, tileSize) == 0 && floorMod(offsetY, tileSize) == 0) {
+                i32 tileX = floorDiv(offsetX, tileSize);
+                i32 tileY = floorDiv(offsetY, tileSize);
+                if (!data.strokeBuffer || !data.strokeBuffer->getTile(tileX, tileY)) {
+                    const Tile* tile = data.canvas->getTile(tileX, tileY);
+                    if (!tile) continue;
+                    if (tile->solid) {
+                        u32 layerPixel = tile->solidColor;
+                        if ((layerPixel & 0xFF) == 0) continue;
+                        if (block.flat) {
+                            block.color = Blend::blend(block.color, layerPixel, data.blend, data.opacity);
+                            block.pending = true;
+                        } else {
+                            Blend::blendSpan(pixels, tile->pixels, Config::TILE_SIZE * Config::TILE_SIZE,
+                                             data.blend, data.opacity);
+                        }
+                        continue;
+                    }
+                }
+            }
+        }
+
+        block.expand();
+        if (!spanPath) {
+            u32 layerRow[Config::TILE_SIZE];
+            for (i32 y = 0; y < tileSize; ++y) {
+                data.sampleRow(data, baseX, baseY + y, Config::TILE_SIZE, layerRow);
+                Blend::blendSpan(pixels + y * tileSize, layerRow, Config::TILE_SIZE, data.blend, data.opacity);
+            }
+            continue;
+        }
+
+        bool isText = data.type == LayerRenderData::Type::Text;
+        const TiledCanvas* source = isText ? data.textCache : data.canvas;
+        i32 offsetX = baseX - static_cast<i32>(data.position.x);
+        i32 offsetY = baseY - static_cast<i32>(data.position.y);
+
+        // Text layers only cover their own canvas
+        i32 startX = 0;
+        i32 endX = tileSize;
+        if (isText) {
+            startX = std::max(0, -offsetX);
+            endX = std::min(tileSize, static_cast<i32>(data.canvasWidth) - offsetX);
+        }
+
+        u32 strokeRow[Config::TILE_SIZE];   // Layer pixels with the live stroke applied
+        for (i32 y = 0; y < tileSize; ++y) {
+            i32 layerY = offsetY + y;
+            if (isText && (layerY < 0 || layerY >= static_cast<i32>(data.canvasHeight))) continue;
+
+            u32* row = pixels + y * tileSize;
+            i32 x = startX;
+            while (x < endX) {
+                u32 count;
+                const u32* src = source->getRow(offsetX + x, layerY, count);
+                const u32* stroke = nullptr;
+                if (data.strokeBuffer) {
+                    u32 strokeCount;
+                    stroke = data.strokeBuffer->getRow(offsetX + x, layerY, strokeCount);
+                    count = std::min(count, strokeCount);
+                }
+                count = std::min(count, static_cast<u32>(endX - x));
+
+                if (stroke) {
+                    std::memcpy(strokeRow, src, count * sizeof(u32));
+                    data.applyStroke(data, strokeRow, stroke, count);
+                    src = strokeRow;
+                }
+                Blend::blendSpan(row + x, src, count, data.blend, data.opacity);
+                x += static_cast<i32>(count);
+            }
+        }
+    }
+}
+
+// Flatten the layers under and over the stroke layer for one tile.
+// Only reads shared state, so tiles can be rendered on worker threads.
+static void renderStrokePlaneTile(const StrokePlanes& planes, const std::vector<LayerRenderData>& layerCache,
+                                  size_t strokeIndex, i32 tileX, i32 tileY,
+                                  std::unique_ptr<Tile>& below, std::unique_ptr<Tile>& above) {
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    const LayerRenderData* first = layerCache.data();
+    const LayerRenderData* stroke = first + strokeIndex;
+    const LayerRenderData* last = first + layerCache.size();
+
+    below = std::make_unique<Tile>();
+    TileBlock belowBlock(below->pixels, true, 0);
+    compositeTileRun(first, stroke, tileX * tileSize, tileY * tileSize, belowBlock);
+    belowBlock.finish();
+    if (belowBlock.flat) below->markSolid(belowBlock.color);
+
+    if (planes.aboveCached) {
+        above = std::make_unique<Tile>();
+        TileBlock aboveBlock(above->pixels, true, 0);
+        compositeTileRun(stroke + 1, last, tileX * tileSize, tileY * tileSize, aboveBlock);
+        aboveBlock.finish();
+        if (aboveBlock.flat) above->markSolid(aboveBlock.color);
+    }
+}
+
+// Flatten one cache tile at the resolution of layerCache (1:1, or a mip level
+// for the reduced cache). While a stroke is active
+// the layers around the stroke layer come from the stroke planes.
+// Only reads shared state, so tiles can be rendered on worker threads.
+static std::unique_ptr<Tile> renderCacheTile(const StrokePlanes& planes,
+                                             const std::vector<LayerRenderData>& layerCache,
+                                             i32 strokeIndex, i32 tileX, i32 tileY) {
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    const LayerRenderData* first = layerCache.data();
+    const LayerRenderData* last = first + layerCache.size();
+    i32 baseX = tileX * tileSize;
+    i32 baseY = tileY * tileSize;
+
+    auto tile = std::make_unique<Tile>();
+    TileBlock block(tile->pixels, true, 0);
+    if (strokeIndex < 0) {
+        compositeTileRun(first, last, baseX, baseY, block);
+    } else {
+        // cached below + live stroke layer + cached (or live) above
+        const LayerRenderData* stroke = first + strokeIndex;
+        if (const Tile* belowTile = planes.below.getTile(tileX, tileY)) {
+            if (belowTile->solid) {
+                block.color = belowTile->solidColor;
+                block.pending = true;
+            } else {
+                std::memcpy(tile->pixels, belowTile->pixels, sizeof(tile->pixels));
+                block.flat = false;
+            }
+        }
+        compositeTileRun(stroke, stroke + 1, baseX, baseY, block);
+
+        if (!planes.aboveCached) {
+            compositeTileRun(stroke + 1, last, baseX, baseY, block);
+        } else if (const Tile* aboveTile = planes.above.getTile(tileX, tileY)) {
+            if (aboveTile->solid && block.flat) {
+                if ((aboveTile->solidColor & 0xFF) > 0) {
+                    block.color = Blend::blend(block.color, aboveTile->solidColor, BlendMode::Normal, 1.0f);
+                    block.pending = true;
+                }
+            } else {
+                block.expand();
+                Blend::blendSpan(tile->pixels, aboveTile->pixels, Config::TILE_SIZE * Config::TILE_SIZE,
+                                 BlendMode::Normal, 1.0f);
+            }
+        }
+    }
+
+    block.finish();
+    if (block.flat) tile->markSolid(block.color);
+    return tile;
+}
+
 void compositeLayer(TiledCanvas& dst, const TiledCanvas& src, BlendMode mode, f32 opacity) {
-    if (opacity <= 0.0f) return;
+    dst.blendCanvas(src, mode, opacity);
+}
 
-    src.forEachPixel([&](u32 x, u32 y, u32 srcPixel) {
-        if ((srcPixel & 0xFF) == 0) return; // Skip transparent pixels
+// Where the view reads the flattened document from
+enum class ViewSource {
+    Reduced,   // Trilinear from the reduced cache's levels
+    Nearest,   // The 1:1 cache, one pixel per screen pixel
+    Magnified, // The 1:1 cache, one pixel per block of screen pixels
+    Mip        // Trilinear from the 1:1 cache and its levels
+};
 
-        u32 dstPixel = dst.getPixel(x, y);
-        u32 result = Blend::blend(dstPixel, srcPixel, mode, opacity);
-        dst.setPixel(x, y, result);
-    });
+// What a band of the view needs to resample the composite cache
+struct ViewSampling {
+    const CompositeCache* cache;
+    const Document::FloatingContent* floating;
+    Rect viewport;
+    f32 zoom;
+    Vec2 pan;
+    f32 viewLod;
+    f32 reducedLod;       // viewLod relative to the reduced cache's level
+    f32 reducedScale;     // Document to reduced cache pixels
+    f32 floatOffsetX;
+    f32 floatOffsetY;
+};
+
+// Flattened pixels for count screen pixels of one row, with any floating
+// content on top. Specialised per view source so the pixel loop has no mode checks.
+template<ViewSource Source, bool Floating>
+static void resampleRow(const ViewSampling& view, TileReader& cacheReader, TileReader& floatReader,
+                        i32 screenX, i32 screenY, u32 count, u32* out) {
+    const CompositeCache& cache = *view.cache;
+    f32 docY = (screenY - view.viewport.y - view.pan.y) / view.zoom;
+
+    for (u32 i = 0; i < count; ++i) {
+        f32 docX = (screenX + static_cast<i32>(i) - view.viewport.x - view.pan.x) / view.zoom;
+
+        u32 composited;
+        if constexpr (Source == ViewSource::Reduced) {
+            composited = cache.reduced.mips.sample(cache.reduced.canvas,
+                                                   (docX + 0.5f) * view.reducedScale - 0.5f,
+                                                   (docY + 0.5f) * view.reducedScale - 0.5f,
+                                                   view.reducedLod);
+        } else if constexpr (Source == ViewSource::Nearest) {
+            composited = cacheReader.getPixel(static_cast<i32>(std::floor(docX)),
+                                              static_cast<i32>(std::floor(docY)));
+        } else {
+            composited = cache.mips.sample(cache.canvas, docX, docY, view.viewLod);
+        }
+
+        // Composite floating content (selection being moved)
+        if constexpr (Floating) {
+            i32 ix = static_cast<i32>(std::floor(docX - view.floatOffsetX));
+            i32 iy = static_cast<i32>(std::floor(docY - view.floatOffsetY));
+            if (ix >= 0 && iy >= 0 &&
+                ix < static_cast<i32>(view.floating->pixels->width) &&
+                iy < static_cast<i32>(view.floating->pixels->height)) {
+                u32 floatPixel = floatReader.getPixel(ix, iy);
+                if ((floatPixel & 0xFF) > 0) {
+                    composited = Blend::blend(composited, floatPixel, BlendMode::Normal, 1.0f);
+                }
+            }
+        }
+
+        out[i] = composited;
+    }
 }
 
-void compositeDocument(Framebuffer& fb, const Document& doc,
-                       const Rect& viewport, f32 zoom, const Vec2& pan) {
+// Document row and floating content row shown on a screen row when sampling
+// the 1:1 cache, using the same mapping as resampleRow
+static void nearestRow(const ViewSampling& view, i32 screenY, i32& docRow, i32& floatRow) {
+    f32 docY = (screenY - view.viewport.y - view.pan.y) / view.zoom;
+    docRow = static_cast<i32>(std::floor(docY));
+    floatRow = static_cast<i32>(std::floor(docY - view.floatOffsetY));
+}
 
-    // Calculate visible document region (no bounds clamping - truly sparse canvas)
-    f32 docLeft = -pan.x / zoom;
-    f32 docTop = -pan.y / zoom;
-    f32 docRight = (viewport.w - pan.x) / zoom;
-    f32 docBottom = (viewport.h - pan.y) / zoom;
+// Same pixels as resampleRow<Nearest>, but each document pixel under the row
+// is read (and blended with floating content) once and then filled across the
+// block of screen pixels it covers
+template<bool Floating>
+static void magnifyRow(const ViewSampling& view, TileReader& cacheReader, TileReader& floatReader,
+                       i32 screenX, i32 screenY, u32 count, u32* out) {
+    i32 docRow, floatRow;
+    nearestRow(view, screenY, docRow, floatRow);
+    const f32 originX = view.viewport.x + view.pan.x - static_cast<f32>(screenX);
+
+    auto docX = [&](u32 i) {
+        return (screenX + static_cast<i32>(i) - view.viewport.x - view.pan.x) / view.zoom;
+    };
 
-    // Check for active stroke buffer from brush or eraser tool
-    TiledCanvas* strokeBuffer = nullptr;
-    PixelLayer* strokeLayer = nullptr;
-    f32 strokeOpacity = 1.0f;
-    bool isEraserStroke = false;
+    u32 i = 0;
+    while (i < count) {
+        f32 x = docX(i);
+        i32 column = static_cast<i32>(std::floor(x));
+        i32 floatColumn = static_cast<i32>(std::floor(x - view.floatOffsetX));
+        auto sameBlock = [&](u32 j) {
+            f32 xj = docX(j);
+            return static_cast<i32>(std::floor(xj)) == column &&
+                   (!Floating || static_cast<i32>(std::floor(xj - view.floatOffsetX)) == floatColumn);
+        };
+
+        // Estimate where the next document column starts, then settle it
+        // against the per-pixel mapping so rounding never shifts a block edge
+        f32 next = std::ceil(static_cast<f32>(column + 1) * view.zoom + originX);
+        u32 end = next <= static_cast<f32>(i + 1) ? i + 1
+                : next >= static_cast<f32>(count) ? count : static_cast<u32>(next);
+        while (end < count && sameBlock(end)) ++end;
+        while (end > i + 1 && !sameBlock(end - 1)) --end;
+
+        u32 composited = cacheReader.getPixel(column, docRow);
+        if constexpr (Floating) {
+            if (floatColumn >= 0 && floatRow >= 0 &&
+                floatColumn < static_cast<i32>(view.floating->pixels->width) &&
+                floatRow < static_cast<i32>(view.floating->pixels->height)) {
+                u32 floatPixel = floatReader.getPixel(floatColumn, floatRow);
+                if ((floatPixel & 0xFF) > 0) {
+                    composited = Blend::blend(composited, floatPixel, BlendMode::Normal, 1.0f);
+                }
+            }
+        }
+
+        std::fill(out + i, out + end, composited);
+        i = end;
+    }
+}
+
+typedef void (*ResampleRowFunction)(const ViewSampling&, TileReader&, TileReader&, i32, i32, u32, u32*);
+
+static ResampleRowFunction selectResampleRow(ViewSource source, bool floating) {
+    switch (source) {
+        case ViewSource::Reduced:
+            return floating ? resampleRow<ViewSource::Reduced, true> : resampleRow<ViewSource::Reduced, false>;
+        case ViewSource::Nearest:
+            return floating ? resampleRow<ViewSource::Nearest, true> : resampleRow<ViewSource::Nearest, false>;
+        case ViewSource::Magnified:
+            return floating ? magnifyRow<true> : magnifyRow<false>;
+        case ViewSource::Mip:
+            break;
+    }
+    return floating ? resampleRow<ViewSource::Mip, true> : resampleRow<ViewSource::Mip, false>;
+}
+
+// Checkerboard under the screen pixels whose document position falls inside
+// rect, so it lines up with the pixels resampled from the document whichever
+// way the screen is split into regions
+static void drawDocumentCheckerboard(Framebuffer& fb, const Rect& rect, i32 originX, i32 originY) {
+    i32 x0 = static_cast<i32>(std::ceil(rect.x));
+    i32 y0 = static_cast<i32>(std::ceil(rect.y));
+    i32 x1 = static_cast<i32>(std::ceil(rect.x + rect.w));
+    i32 y1 = static_cast<i32>(std::ceil(rect.y + rect.h));
+    fb.drawCheckerboard(Recti(x0, y0, x1 - x0, y1 - y0), Config::CHECKER_COLOR1, Config::CHECKER_COLOR2,
+                        Config::CHECKER_SIZE, originX, originY);
+}
+
+void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                       const Rect& viewport, f32 zoom, const Vec2& pan, bool pixelGrid) {
+    // Restrict work to the framebuffer's active clip (the dirty rect being redrawn)
+    std::vector<Recti> regions;
+    if (fb.hasClip()) {
+        regions.push_back(fb.currentClip());
+    } else {
+        regions.push_back(Recti(viewport));
+    }
+    compositeDocument(fb, doc, cache, viewport, zoom, pan, regions, pixelGrid);
+}
+
+ActiveStroke findActiveStroke(const Document& doc) {
+    ActiveStroke stroke;
     if (Tool* tool = const_cast<Document&>(doc).getTool()) {
         if (BrushTool* brushTool = dynamic_cast<BrushTool*>(tool)) {
             if (brushTool->isStroking()) {
-                strokeBuffer = brushTool->getStrokeBuffer();
-                strokeLayer = brushTool->getStrokeLayer();
-                strokeOpacity = brushTool->getStrokeOpacity();
+                stroke.buffer = brushTool->getStrokeBuffer();
+                stroke.layer = brushTool->getStrokeLayer();
+                stroke.opacity = brushTool->getStrokeOpacity();
             }
         } else if (EraserTool* eraserTool = dynamic_cast<EraserTool*>(tool)) {
             if (eraserTool->isStroking()) {
-                strokeBuffer = eraserTool->getStrokeBuffer();
-                strokeLayer = eraserTool->getStrokeLayer();
-                strokeOpacity = eraserTool->getStrokeOpacity();
-                isEraserStroke = true;
+                stroke.buffer = eraserTool->getStrokeBuffer();
+                stroke.layer = eraserTool->getStrokeLayer();
+                stroke.opacity = eraserTool->getStrokeOpacity();
+                stroke.eraser = true;
             }
         }
     }
+    return stroke;
+}
+
+void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                       const Rect& viewport, f32 zoom, const Vec2& pan,
+                       const std::vector<Recti>& regions, bool pixelGrid) {
+    compositeDocument(fb, doc, cache, findActiveStroke(doc), viewport, zoom, pan, regions, pixelGrid);
+}
 
-    // Draw checkerboard background for document area only
+void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                       const ActiveStroke& stroke,
+                       const Rect& viewport, f32 zoom, const Vec2& pan,
+                       const std::vector<Recti>& regions, bool pixelGrid) {
+    const TiledCanvas* strokeBuffer = stroke.buffer;
+    const PixelLayer* strokeLayer = stroke.layer;
+    const f32 strokeOpacity = stroke.opacity;
+    const bool isEraserStroke = stroke.eraser;
+
+    // Screen rect of the document area, clamped to the viewport
     Rect docScreenRect(
         pan.x + viewport.x,
         pan.y + viewport.y,
@@ -84,11 +652,15 @@ void compositeDocument(Framebuffer& fb, const Document& doc,
         doc.height * zoom
     );
     Rect clippedDocRect = docScreenRect.intersection(viewport);
-    drawCheckerboard(fb, clippedDocRect);
 
     // Choose sampling mode based on zoom
     SampleMode sampleMode = zoom < 1.0f ? SampleMode::Bilinear : SampleMode::Nearest;
 
+    // Checkerboard squares line up with the document's corner, so they stay
+    // put relative to the document when the view pans
+    const i32 docOriginX = static_cast<i32>(std::floor(viewport.x + pan.x));
+    const i32 docOriginY = static_cast<i32>(std::floor(viewport.y + pan.y));
+
     // Calculate screen bounds of document area for clipping
     i32 docScreenX0 = static_cast<i32>(viewport.x + pan.x);
     i32 docScreenY0 = static_cast<i32>(viewport.y + pan.y);
@@ -100,15 +672,37 @@ void compositeDocument(Framebuffer& fb, const Document& doc,
     i32 renderY0 = std::max(static_cast<i32>(viewport.y), docScreenY0);
     i32 renderX1 = std::min(static_cast<i32>(viewport.x + viewport.w), docScreenX1);
     i32 renderY1 = std::min(static_cast<i32>(viewport.y + viewport.h), docScreenY1);
+    Recti renderRect(renderX0, renderY0, renderX1 - renderX0, renderY1 - renderY0);
+
+    // Intersect the requested regions with the document area up front so that
+    // nothing below touches pixels outside of them
+    std::vector<Recti> renderRegions;
+    renderRegions.reserve(regions.size());
+    for (const Recti& region : regions) {
+        Recti r = region.intersection(renderRect);
+        if (fb.hasClip()) r = r.intersection(fb.currentClip());
+        if (!r.isEmpty()) renderRegions.push_back(r);
+    }
+
+    // Nothing to draw when no region overlaps the document area
+    if (renderRegions.empty()) return;
 
     // Pre-compute layer render data to avoid per-pixel virtual calls and matrix inversions
     std::vector<LayerRenderData> layerCache;
     layerCache.reserve(doc.layers.size());
+    bool textChanged = false;
+
+    // Adjustment tables are brought up to date here, before worker
+    // threads read them. Runs of adjustments become a single entry.
+    std::vector<const AdjustmentLut*> adjustments = fuseAdjustments(doc.layers);
 
-    for (const auto& layer : doc.layers) {
+    for (size_t layerIndex = 0; layerIndex < doc.layers.size(); ++layerIndex) {
+        const auto& layer = doc.layers[layerIndex];
         if (!layer->visible) continue;
+        if (layer->isAdjustmentLayer() && !adjustments[layerIndex]) continue;
 
         LayerRenderData data;
+        data.layer = layer.get();
         data.blend = layer->blend;
         data.opacity = layer->opacity;
         data.position = layer->transform.position;
@@ -128,9 +722,11 @@ void compositeDocument(Framebuffer& fb, const Document& doc,
             if (data.hasTransform) {
                 Matrix3x2 mat = layer->transform.toMatrix(data.canvasWidth, data.canvasHeight);
                 data.invMatrix = mat.inverted();
+                data.sourceBounds = pixelLayer->canvas.getBounds();
             }
 
             // Check if this layer has an active stroke buffer
+            data.isStrokeLayer = strokeLayer == pixelLayer;
             if (strokeBuffer && strokeLayer == pixelLayer) {
                 data.strokeBuffer = strokeBuffer;
                 data.strokeOpacity = strokeOpacity;
@@ -140,6 +736,7 @@ void compositeDocument(Framebuffer& fb, const Document& doc,
         else if (layer->isTextLayer()) {
             data.type = LayerRenderData::Type::Text;
             TextLayer* textLayer = const_cast<TextLayer*>(static_cast<const TextLayer*>(layer.get()));
+            if (!textLayer->cacheValid) textChanged = true;
             textLayer->ensureCacheValid();
             data.textCache = &textLayer->rasterizedCache;
             data.canvasWidth = textLayer->rasterizedCache.width;
@@ -153,404 +750,357 @@ void compositeDocument(Framebuffer& fb, const Document& doc,
             if (data.hasTransform) {
                 Matrix3x2 mat = layer->transform.toMatrix(data.canvasWidth, data.canvasHeight);
                 data.invMatrix = mat.inverted();
+                data.sourceBounds = textLayer->rasterizedCache.getBounds();
             }
         }
         else if (layer->isAdjustmentLayer()) {
             data.type = LayerRenderData::Type::Adjustment;
-            data.adjustment = static_cast<const AdjustmentLayer*>(layer.get());
+            data.adjustment = adjustments[layerIndex];
             data.hasTransform = false;
         }
 
+        selectRowFunctions(data);
         layerCache.push_back(data);
     }
 
-    // Pre-compute floating content offset if active
-    const bool hasFloating = doc.floatingContent.active && doc.floatingContent.pixels;
-    f32 floatOffsetX = 0, floatOffsetY = 0;
-    if (hasFloating) {
-        floatOffsetX = doc.floatingContent.originalBounds.x + doc.floatingContent.currentOffset.x;
-        floatOffsetY = doc.floatingContent.originalBounds.y + doc.floatingContent.currentOffset.y;
+    // Document area behind the regions
+    f32 areaX0 = 0, areaY0 = 0, areaX1 = 0, areaY1 = 0;
+    for (size_t i = 0; i < renderRegions.size(); ++i) {
+        const Recti& region = renderRegions[i];
+        f32 x0 = (region.x - viewport.x - pan.x) / zoom;
+        f32 y0 = (region.y - viewport.y - pan.y) / zoom;
+        f32 x1 = (region.x + region.w - viewport.x - pan.x) / zoom;
+        f32 y1 = (region.y + region.h - viewport.y - pan.y) / zoom;
+        areaX0 = i == 0 ? x0 : std::min(areaX0, x0);
+        areaY0 = i == 0 ? y0 : std::min(areaY0, y0);
+        areaX1 = i == 0 ? x1 : std::max(areaX1, x1);
+        areaY1 = i == 0 ? y1 : std::max(areaY1, y1);
+    }
+    Rect docArea(areaX0, areaY0, areaX1 - areaX0, areaY1 - areaY0);
+
+    // Zoomed out, sample mip levels so each screen pixel averages the
+    // document pixels under it instead of picking four of them
+    const f32 viewLod = zoom < 1.0f ? std::log2(1.0f / zoom) : 0.0f;
+    const u32 viewLevel = MipPyramid::levelFor(viewLod);
+
+    // The view only resamples the flattened document: at 1:1 resolution
+    // down to the cache zoom threshold, and below it at the power-of-two
+    // scale just above the zoom, flattened from the layers' mip levels.
+    // Make sure every cache tile the regions touch is up to date.
+    const u32 reducedLevel = zoom < Config::COMPOSITE_CACHE_MIN_ZOOM
+                                 ? static_cast<u32>(std::floor(viewLod)) : 0;
+
+    u64 signature = CompositeCache::computeSignature(doc);
+    u64 contentSignature = CompositeCache::computeContentSignature(doc);
+    if (signature != cache.signature || contentSignature != cache.contentSignature ||
+        textChanged) {
+        cache.invalidate();
+        cache.setBounds(doc.width, doc.height);
+        cache.signature = signature;
+        cache.contentSignature = contentSignature;
     }
 
-    // Only render within document bounds (clipped to viewport)
-    for (i32 screenY = renderY0; screenY < renderY1; ++screenY) {
-        f32 docY = (screenY - viewport.y - pan.y) / zoom;
-
-        for (i32 screenX = renderX0; screenX < renderX1; ++screenX) {
-            f32 docX = (screenX - viewport.x - pan.x) / zoom;
-
-            // Composite all layers at this pixel using cached data
-            u32 composited = 0;
-
-            for (const auto& data : layerCache) {
-                if (data.type == LayerRenderData::Type::Adjustment) {
-                    composited = applyAdjustment(composited, *data.adjustment);
-                    continue;
-                }
-
-                u32 layerPixel = 0;
-                f32 layerX, layerY;
-                SampleMode actualMode = sampleMode;
-
-                if (data.hasTransform) {
-                    Vec2 srcCoord = data.invMatrix.transform(Vec2(docX, docY));
-                    layerX = srcCoord.x;
-                    layerY = srcCoord.y;
-                    actualMode = SampleMode::Bilinear;
-                } else {
-                    layerX = docX - data.position.x;
-                    layerY = docY - data.position.y;
-                }
-
-                if (data.type == LayerRenderData::Type::Pixel) {
-                    if (actualMode == SampleMode::Nearest) {
-                        i32 ix = static_cast<i32>(std::floor(layerX));
-                        i32 iy = static_cast<i32>(std::floor(layerY));
-                        layerPixel = data.canvas->getPixel(ix, iy);
-                    } else {
-                        layerPixel = Sampler::sample(*data.canvas, layerX, layerY, actualMode);
-                    }
-
-                    // Composite stroke buffer preview if this layer has one
-                    if (data.strokeBuffer) {
-                        i32 ix = static_cast<i32>(std::floor(layerX));
-                        i32 iy = static_cast<i32>(std::floor(layerY));
-                        u32 strokePixel = data.strokeBuffer->getPixel(ix, iy);
-                        if ((strokePixel & 0xFF) > 0) {
-                            if (data.isEraserStroke) {
-                                u8 eraseAmount = strokePixel & 0xFF;
-                                f32 eraseFactor = (eraseAmount / 255.0f) * data.strokeOpacity;
-                                u8 r, g, b, a;
-                                Blend::unpack(layerPixel, r, g, b, a);
-                                a = static_cast<u8>(a * (1.0f - eraseFactor));
-                                layerPixel = Blend::pack(r, g, b, a);
-                            } else {
-                                layerPixel = Blend::blend(layerPixel, strokePixel, BlendMode::Normal, data.strokeOpacity);
-                            }
-                        }
-                    }
-                }
-                else if (data.type == LayerRenderData::Type::Text) {
-                    if (actualMode == SampleMode::Nearest) {
-                        i32 ix = static_cast<i32>(layerX);
-                        i32 iy = static_cast<i32>(layerY);
-                        if (ix >= 0 && iy >= 0 && ix < static_cast<i32>(data.canvasWidth) &&
-                            iy < static_cast<i32>(data.canvasHeight)) {
-                            layerPixel = data.textCache->getPixel(ix, iy);
-                        }
-                    } else {
-                        layerPixel = Sampler::sample(*data.textCache, layerX, layerY, actualMode);
-                    }
-                }
-
-                if ((layerPixel & 0xFF) > 0) {
-                    composited = Blend::blend(composited, layerPixel, data.blend, data.opacity);
-                }
+    ThreadPool& pool = ThreadPool::instance();
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+
+    // Document area of the whole visible view, not just the regions. Cache
+    // tiles under it are kept when the caches go over their size limit.
+    const f32 viewX0 = (renderRect.x - viewport.x - pan.x) / zoom;
+    const f32 viewY0 = (renderRect.y - viewport.y - pan.y) / zoom;
+    const f32 viewX1 = (renderRect.x + renderRect.w - viewport.x - pan.x) / zoom;
+    const f32 viewY1 = (renderRect.y + renderRect.h - viewport.y - pan.y) / zoom;
+    if (reducedLevel > 0) {
+        ReducedCache& reduced = cache.reduced;
+        cache.setReducedLevel(reducedLevel, doc.width, doc.height);
+
+        // The layer stack as seen at this level: every canvas replaced by
+        // its mip level and positions scaled down to match
+        const f32 levelScale = 1.0f / static_cast<f32>(1u << reducedLevel);
+        std::vector<LayerRenderData> levelLayers = layerCache;
+        bool hasStroke = false;
+        for (LayerRenderData& data : levelLayers) {
+            if (data.type == LayerRenderData::Type::Adjustment) continue;
+
+            Recti sourceRect = layerSourceRect(data, docArea, reducedLevel);
+            if (data.type == LayerRenderData::Type::Pixel) {
+                const PixelLayer* pixelLayer = static_cast<const PixelLayer*>(data.layer);
+                pixelLayer->mips.prepare(*data.canvas, reducedLevel, sourceRect);
+                data.canvas = &pixelLayer->mips.getLevel(*data.canvas, reducedLevel);
+                data.canvasWidth = data.canvas->width;
+                data.canvasHeight = data.canvas->height;
+            } else {
+                const TextLayer* textLayer = static_cast<const TextLayer*>(data.layer);
+                textLayer->mips.prepare(*data.textCache, reducedLevel, sourceRect);
+                data.textCache = &textLayer->mips.getLevel(*data.textCache, reducedLevel);
+                data.canvasWidth = data.textCache->width;
+                data.canvasHeight = data.textCache->height;
             }
 
-            // Composite floating content (selection being moved)
-            if (hasFloating) {
-                f32 floatX = docX - floatOffsetX;
-                f32 floatY = docY - floatOffsetY;
-
-                i32 ix = static_cast<i32>(std::floor(floatX));
-                i32 iy = static_cast<i32>(std::floor(floatY));
-
-                if (ix >= 0 && iy >= 0 &&
-                    ix < static_cast<i32>(doc.floatingContent.pixels->width) &&
-                    iy < static_cast<i32>(doc.floatingContent.pixels->height)) {
-                    u32 floatPixel = doc.floatingContent.pixels->getPixel(ix, iy);
-                    if ((floatPixel & 0xFF) > 0) {
-                        composited = Blend::blend(composited, floatPixel, BlendMode::Normal, 1.0f);
-                    }
-                }
+            if (data.strokeBuffer) {
+                reduced.strokeMips.prepare(*data.strokeBuffer, reducedLevel, sourceRect);
+                data.strokeBuffer = &reduced.strokeMips.getLevel(*data.strokeBuffer, reducedLevel);
+                hasStroke = true;
             }
 
-            // Blend composited pixel onto framebuffer (checkerboard background)
-            if ((composited & 0xFF) > 0) {
-                fb.blendPixel(screenX, screenY, composited);
+            data.position = data.position * levelScale;
+            data.invMatrix.m[4] *= levelScale;
+            data.invMatrix.m[5] *= levelScale;
+            if (data.hasTransform) {
+                const TiledCanvas& level = data.type == LayerRenderData::Type::Pixel ? *data.canvas : *data.textCache;
+                data.sourceBounds = level.getBounds();
             }
         }
-    }
-
-    // Draw selection marching ants if selection exists
-    if (doc.selection.hasSelection) {
-        u64 time = Platform::getMilliseconds();
-        drawMarchingAnts(fb, doc.selection, viewport, zoom, pan, time);
-    }
-}
-
-void drawCheckerboard(Framebuffer& fb, const Rect& rect,
-                      u32 color1, u32 color2) {
-    // Use framebuffer's optimized checkerboard drawing
-    Recti intRect(static_cast<i32>(rect.x), static_cast<i32>(rect.y),
-                  static_cast<i32>(rect.w), static_cast<i32>(rect.h));
-    fb.drawCheckerboard(intRect, color1, color2, Config::CHECKER_SIZE);
-}
-
-u32 applyAdjustment(u32 pixel, const AdjustmentLayer& adj) {
-    if ((pixel & 0xFF) == 0) return pixel;
-
-    u8 r, g, b, a;
-    Blend::unpack(pixel, r, g, b, a);
-
-    f32 fr = r / 255.0f;
-    f32 fg = g / 255.0f;
-    f32 fb_color = b / 255.0f;
-
-    switch (adj.type) {
-        case AdjustmentType::BrightnessContrast: {
-            const auto* params = std::get_if<BrightnessContrastParams>(&adj.params);
-            if (params) {
-                f32 brightness = params->brightness / 100.0f;
-                f32 contrast = (params->contrast + 100.0f) / 100.0f;
-
-                fr = (fr - 0.5f) * contrast + 0.5f + brightness;
-                fg = (fg - 0.5f) * contrast + 0.5f + brightness;
-                fb_color = (fb_color - 0.5f) * contrast + 0.5f + brightness;
+        if (!hasStroke) reduced.strokeMips.clear();
+
+        // Reduced cache pixels under the regions, padded for trilinear sampling
+        Recti levelRect = mipSampleRect((areaX0 + 0.5f) * levelScale - 0.5f,
+                                        (areaY0 + 0.5f) * levelScale - 0.5f,
+                                        (areaX1 + 0.5f) * levelScale - 0.5f,
+                                        (areaY1 + 0.5f) * levelScale - 0.5f, 1);
+        std::vector<u64> missingTiles;
+        for (i32 ty = floorDiv(levelRect.y, tileSize); ty <= floorDiv(levelRect.y + levelRect.h - 1, tileSize); ++ty) {
+            for (i32 tx = floorDiv(levelRect.x, tileSize); tx <= floorDiv(levelRect.x + levelRect.w - 1, tileSize); ++tx) {
+                u64 key = makeTileKey(tx, ty);
+                if (!reduced.validTiles.count(key)) missingTiles.push_back(key);
             }
-            break;
         }
 
-        case AdjustmentType::HueSaturation: {
-            const auto* params = std::get_if<HueSaturationParams>(&adj.params);
-            if (params) {
-                // Convert to HSL
-                f32 maxC = std::max({fr, fg, fb_color});
-                f32 minC = std::min({fr, fg, fb_color});
-                f32 l = (maxC + minC) / 2.0f;
-
-                if (maxC != minC) {
-                    f32 d = maxC - minC;
-                    f32 s = l > 0.5f ? d / (2.0f - maxC - minC) : d / (maxC + minC);
-
-                    f32 h = 0;
-                    if (maxC == fr) {
-                        h = (fg - fb_color) / d + (fg < fb_color ? 6.0f : 0.0f);
-                    } else if (maxC == fg) {
-                        h = (fb_color - fr) / d + 2.0f;
-                    } else {
-                        h = (fr - fg) / d + 4.0f;
-                    }
-                    h /= 6.0f;
-
-                    // Apply adjustments
-                    h += params->hue / 360.0f;
-                    while (h < 0) h += 1.0f;
-                    while (h >= 1.0f) h -= 1.0f;
-
-                    s *= 1.0f + params->saturation / 100.0f;
-                    s = clamp(s, 0.0f, 1.0f);
-
-                    l += params->lightness / 100.0f;
-                    l = clamp(l, 0.0f, 1.0f);
-
-                    // Convert back to RGB
-                    auto hue2rgb = [](f32 p, f32 q, f32 t) {
-                        if (t < 0) t += 1.0f;
-                        if (t > 1) t -= 1.0f;
-                        if (t < 1.0f/6.0f) return p + (q - p) * 6.0f * t;
-                        if (t < 1.0f/2.0f) return q;
-                        if (t < 2.0f/3.0f) return p + (q - p) * (2.0f/3.0f - t) * 6.0f;
-                        return p;
-                    };
-
-                    f32 q = l < 0.5f ? l * (1.0f + s) : l + s - l * s;
-                    f32 p = 2.0f * l - q;
-
-                    fr = hue2rgb(p, q, h + 1.0f/3.0f);
-                    fg = hue2rgb(p, q, h);
-                    fb_color = hue2rgb(p, q, h - 1.0f/3.0f);
-                }
-            }
-            break;
+        std::vector<std::unique_ptr<Tile>> levelTiles(missingTiles.size());
+        pool.parallelFor(static_cast<u32>(missingTiles.size()), [&](u32 i) {
+            i32 tx, ty;
+            extractTileCoords(missingTiles[i], tx, ty);
+            levelTiles[i] = renderCacheTile(cache.strokePlanes, levelLayers, -1, tx, ty);
+        });
+        for (size_t i = 0; i < missingTiles.size(); ++i) {
+            storeTile(reduced.canvas, missingTiles[i], std::move(levelTiles[i]));
+            reduced.validTiles.insert(missingTiles[i]);
         }
 
-        case AdjustmentType::Invert: {
-            fr = 1.0f - fr;
-            fg = 1.0f - fg;
-            fb_color = 1.0f - fb_color;
-            break;
+        Recti levelView = mipSampleRect((viewX0 + 0.5f) * levelScale - 0.5f,
+                                        (viewY0 + 0.5f) * levelScale - 0.5f,
+                                        (viewX1 + 0.5f) * levelScale - 0.5f,
+                                        (viewY1 + 0.5f) * levelScale - 0.5f, 1);
+        reduced.evictOutside(tileRect(levelView), Config::COMPOSITE_CACHE_MAX_TILES);
+
+        reduced.mips.prepare(reduced.canvas, 1, levelRect);
+    } else {
+        // While painting, keep the layers under and over the stroke layer
+        // flattened so dirty tiles only re-blend the stroke layer itself
+        i32 strokeIndex = -1;
+        for (size_t i = 0; i < layerCache.size(); ++i) {
+            if (layerCache[i].isStrokeLayer) strokeIndex = static_cast<i32>(i);
         }
-
-        case AdjustmentType::Exposure: {
-            const auto* params = std::get_if<ExposureParams>(&adj.params);
-            if (params) {
-                f32 exposure = std::pow(2.0f, params->exposure);
-                fr = std::pow(fr * exposure + params->offset, 1.0f / params->gamma);
-                fg = std::pow(fg * exposure + params->offset, 1.0f / params->gamma);
-                fb_color = std::pow(fb_color * exposure + params->offset, 1.0f / params->gamma);
+        StrokePlanes& planes = cache.strokePlanes;
+        if (strokeIndex < 0) {
+            planes.reset();
+        } else {
+            const LayerBase* layer = layerCache[strokeIndex].layer;
+            u64 planesContent = CompositeCache::computeContentSignature(doc, layer);
+            if (planes.layer != layer || planes.signature != signature ||
+                planes.contentSignature != planesContent) {
+                planes.reset();
+                planes.layer = layer;
+                planes.signature = signature;
+                planes.contentSignature = planesContent;
+
+                // Over-compositing is associative, so layers above can be
+                // pre-flattened as long as they all use Normal blending
+                planes.aboveCached = true;
+                for (size_t i = strokeIndex + 1; i < layerCache.size(); ++i) {
+                    if (layerCache[i].type == LayerRenderData::Type::Adjustment ||
+                        layerCache[i].blend != BlendMode::Normal) {
+                        planes.aboveCached = false;
+                        break;
+                    }
+                }
             }
-            break;
         }
 
-        case AdjustmentType::BlackAndWhite: {
-            const auto* params = std::get_if<BlackAndWhiteParams>(&adj.params);
-            if (params) {
-                // Simple grayscale conversion weighted by color channels
-                f32 gray = fr * (params->reds / 100.0f) +
-                           fg * (params->greens / 100.0f) +
-                           fb_color * (params->blues / 100.0f);
-                gray = clamp(gray, 0.0f, 1.0f);
-
-                if (params->tintAmount > 0) {
-                    // Apply tint (simplified)
-                    f32 t = params->tintAmount / 100.0f;
-                    // Tint towards sepia-like color based on hue
-                    f32 tintR = 1.0f, tintG = 0.9f, tintB = 0.7f;
-                    fr = gray * (1.0f - t) + gray * tintR * t;
-                    fg = gray * (1.0f - t) + gray * tintG * t;
-                    fb_color = gray * (1.0f - t) + gray * tintB * t;
-                } else {
-                    fr = fg = fb_color = gray;
+        // Collect the cache tiles the regions need that are not up to date
+        std::vector<u64> missingTiles;
+        std::unordered_set<u64> seenTiles;
+        for (const Recti& region : renderRegions) {
+            // Bilinear sampling also reads the next pixel right/down, and
+            // mip levels read a few pixels around either side
+            i32 pad = viewLevel > 0 ? (2 << viewLevel) : 0;
+            i32 extra = pad + (sampleMode == SampleMode::Bilinear ? 1 : 0);
+            i32 docX0 = static_cast<i32>(std::floor((region.x - viewport.x - pan.x) / zoom)) - pad;
+            i32 docY0 = static_cast<i32>(std::floor((region.y - viewport.y - pan.y) / zoom)) - pad;
+            i32 docX1 = static_cast<i32>(std::floor((region.x + region.w - 1 - viewport.x - pan.x) / zoom)) + extra;
+            i32 docY1 = static_cast<i32>(std::floor((region.y + region.h - 1 - viewport.y - pan.y) / zoom)) + extra;
+
+            for (i32 ty = floorDiv(docY0, tileSize); ty <= floorDiv(docY1, tileSize); ++ty) {
+                for (i32 tx = floorDiv(docX0, tileSize); tx <= floorDiv(docX1, tileSize); ++tx) {
+                    u64 key = makeTileKey(tx, ty);
+                    if (!cache.validTiles.count(key) && seenTiles.insert(key).second) {
+                        missingTiles.push_back(key);
+                    }
                 }
             }
-            break;
         }
 
-        case AdjustmentType::TemperatureTint: {
-            const auto* params = std::get_if<TemperatureTintParams>(&adj.params);
-            if (params) {
-                // Temperature: negative = cooler (blue), positive = warmer (orange)
-                f32 temp = params->temperature / 100.0f;
-                // Tint: negative = green, positive = magenta
-                f32 tint = params->tint / 100.0f;
-
-                fr += temp * 0.3f;
-                fb_color -= temp * 0.3f;
-                fg -= tint * 0.3f;
-                fr += tint * 0.15f;
-                fb_color += tint * 0.15f;
+        // Tiles are rendered in parallel into per-tile slots and stored serially
+        // afterwards, so the result does not depend on scheduling
+        if (strokeIndex >= 0) {
+            std::vector<u64> missingPlanes;
+            for (u64 key : missingTiles) {
+                if (!planes.validTiles.count(key)) missingPlanes.push_back(key);
             }
-            break;
-        }
 
-        case AdjustmentType::Vibrance: {
-            const auto* params = std::get_if<VibranceParams>(&adj.params);
-            if (params) {
-                // Vibrance increases saturation of less-saturated colors more
-                f32 maxC = std::max({fr, fg, fb_color});
-                f32 minC = std::min({fr, fg, fb_color});
-                f32 sat = (maxC > 0) ? (maxC - minC) / maxC : 0.0f;
-
-                // Less saturated colors get more boost
-                f32 boost = (1.0f - sat) * (params->vibrance / 100.0f);
-                f32 avg = (fr + fg + fb_color) / 3.0f;
-
-                fr = fr + (fr - avg) * boost;
-                fg = fg + (fg - avg) * boost;
-                fb_color = fb_color + (fb_color - avg) * boost;
+            std::vector<std::unique_ptr<Tile>> belowTiles(missingPlanes.size());
+            std::vector<std::unique_ptr<Tile>> aboveTiles(missingPlanes.size());
+            pool.parallelFor(static_cast<u32>(missingPlanes.size()), [&](u32 i) {
+                i32 tx, ty;
+                extractTileCoords(missingPlanes[i], tx, ty);
+                renderStrokePlaneTile(planes, layerCache, static_cast<size_t>(strokeIndex),
+                                      tx, ty, belowTiles[i], aboveTiles[i]);
+            });
+            for (size_t i = 0; i < missingPlanes.size(); ++i) {
+                storeTile(planes.below, missingPlanes[i], std::move(belowTiles[i]));
+                storeTile(planes.above, missingPlanes[i], std::move(aboveTiles[i]));
+                planes.validTiles.insert(missingPlanes[i]);
             }
-            break;
         }
 
-        case AdjustmentType::ColorBalance: {
-            const auto* params = std::get_if<ColorBalanceParams>(&adj.params);
-            if (params) {
-                // Determine luminance to weight shadows/midtones/highlights
-                f32 lum = 0.299f * fr + 0.587f * fg + 0.114f * fb_color;
-
-                // Shadow influence (more for dark pixels)
-                f32 shadowWeight = 1.0f - clamp(lum * 2.0f, 0.0f, 1.0f);
-                // Highlight influence (more for bright pixels)
-                f32 highlightWeight = clamp((lum - 0.5f) * 2.0f, 0.0f, 1.0f);
-                // Midtone influence (peak at middle luminance)
-                f32 midtoneWeight = 1.0f - std::abs(lum - 0.5f) * 2.0f;
-                midtoneWeight = clamp(midtoneWeight, 0.0f, 1.0f);
-
-                // Apply shadows adjustments
-                fr += shadowWeight * params->shadowsCyanRed / 100.0f * 0.5f;
-                fg += shadowWeight * params->shadowsMagentaGreen / 100.0f * 0.5f;
-                fb_color += shadowWeight * params->shadowsYellowBlue / 100.0f * 0.5f;
-
-                // Apply midtones adjustments
-                fr += midtoneWeight * params->midtonesCyanRed / 100.0f * 0.5f;
-                fg += midtoneWeight * params->midtonesMagentaGreen / 100.0f * 0.5f;
-                fb_color += midtoneWeight * params->midtonesYellowBlue / 100.0f * 0.5f;
-
-                // Apply highlights adjustments
-                fr += highlightWeight * params->highlightsCyanRed / 100.0f * 0.5f;
-                fg += highlightWeight * params->highlightsMagentaGreen / 100.0f * 0.5f;
-                fb_color += highlightWeight * params->highlightsYellowBlue / 100.0f * 0.5f;
-            }
-            break;
+        std::vector<std::unique_ptr<Tile>> cacheTiles(missingTiles.size());
+        pool.parallelFor(static_cast<u32>(missingTiles.size()), [&](u32 i) {
+            i32 tx, ty;
+            extractTileCoords(missingTiles[i], tx, ty);
+            cacheTiles[i] = renderCacheTile(planes, layerCache, strokeIndex, tx, ty);
+        });
+        for (size_t i = 0; i < missingTiles.size(); ++i) {
+            storeTile(cache.canvas, missingTiles[i], std::move(cacheTiles[i]));
+            cache.validTiles.insert(missingTiles[i]);
         }
 
-        case AdjustmentType::HighlightsShadows: {
-            const auto* params = std::get_if<HighlightsShadowsParams>(&adj.params);
-            if (params) {
-                f32 lum = 0.299f * fr + 0.587f * fg + 0.114f * fb_color;
+        Recti viewTiles = tileRect(mipSampleRect(viewX0, viewY0, viewX1, viewY1, viewLevel));
+        cache.evictOutside(viewTiles, Config::COMPOSITE_CACHE_MAX_TILES);
+        if (strokeIndex >= 0) planes.evictOutside(viewTiles, Config::COMPOSITE_CACHE_MAX_TILES);
 
-                // Shadow recovery (brighten dark areas)
-                f32 shadowMask = 1.0f - clamp(lum * 2.0f, 0.0f, 1.0f);
-                f32 shadowBoost = shadowMask * params->shadows / 100.0f;
+        if (viewLevel > 0) {
+            cache.mips.prepare(cache.canvas, viewLevel,
+                               mipSampleRect(areaX0, areaY0, areaX1, areaY1, viewLevel));
+        }
+    }
 
-                // Highlight recovery (darken bright areas)
-                f32 highlightMask = clamp((lum - 0.5f) * 2.0f, 0.0f, 1.0f);
-                f32 highlightBoost = -highlightMask * params->highlights / 100.0f;
+    // Pre-compute floating content offset if active
+    const bool hasFloating = doc.floatingContent.active && doc.floatingContent.pixels;
+    ViewSampling view;
+    view.cache = &cache;
+    view.floating = &doc.floatingContent;
+    view.viewport = viewport;
+    view.zoom = zoom;
+    view.pan = pan;
+    view.viewLod = viewLod;
+    view.reducedLod = viewLod - static_cast<f32>(reducedLevel);
+    view.reducedScale = 1.0f / static_cast<f32>(1u << reducedLevel);
+    view.floatOffsetX = 0;
+    view.floatOffsetY = 0;
+    if (hasFloating) {
+        view.floatOffsetX = doc.floatingContent.originalBounds.x + doc.floatingContent.currentOffset.x;
+        view.floatOffsetY = doc.floatingContent.originalBounds.y + doc.floatingContent.currentOffset.y;
+    }
 
-                f32 adjustment = shadowBoost + highlightBoost;
-                fr += adjustment;
-                fg += adjustment;
-                fb_color += adjustment;
+    ViewSource source = reducedLevel > 0 ? ViewSource::Reduced
+                      : zoom >= 2.0f ? ViewSource::Magnified
+                      : sampleMode == SampleMode::Nearest ? ViewSource::Nearest
+                      : ViewSource::Mip;
+    const bool repeatsRows = source == ViewSource::Magnified || source == ViewSource::Nearest;
+    const bool drawGrid = source == ViewSource::Magnified && pixelGrid && zoom >= Config::PIXEL_GRID_MIN_ZOOM;
+    ResampleRowFunction resample = selectResampleRow(source, hasFloating);
+
+    // Only evaluate layer stacks for pixels inside the requested regions.
+    // Each region redraws its own checkerboard so overlapping regions never
+    // blend the same pixel twice; regions are processed one after another
+    // and split into tile-aligned row bands for the worker pool.
+    const i32 bandHeight = static_cast<i32>(Config::TILE_SIZE);
+    for (const Recti& region : renderRegions) {
+        drawDocumentCheckerboard(fb, clippedDocRect.intersection(region.toRect()), docOriginX, docOriginY);
+
+        // Pixel grid lines run along the first screen column (and row) of
+        // every document pixel after the first
+        std::vector<i32> gridColumns;
+        i32 gridX0 = region.x + region.w, gridX1 = region.x;
+        if (drawGrid) {
+            auto column = [&](i32 screenX) {
+                return static_cast<i32>(std::floor((screenX - viewport.x - pan.x) / zoom));
+            };
+            i32 prev = column(region.x - 1);
+            for (i32 x = region.x; x < region.x + region.w; ++x) {
+                i32 current = column(x);
+                if (current >= 0 && current < static_cast<i32>(doc.width)) {
+                    gridX0 = std::min(gridX0, x);
+                    gridX1 = x + 1;
+                    if (current != prev && current > 0) gridColumns.push_back(x);
+                }
+                prev = current;
             }
-            break;
         }
 
-        case AdjustmentType::Levels: {
-            const auto* params = std::get_if<LevelsParams>(&adj.params);
-            if (params) {
-                // Input levels: remap input range
-                f32 inBlack = params->inputBlack / 255.0f;
-                f32 inWhite = params->inputWhite / 255.0f;
-                f32 gamma = params->inputGamma;
-
-                // Output levels
-                f32 outBlack = params->outputBlack / 255.0f;
-                f32 outWhite = params->outputWhite / 255.0f;
-
-                auto applyLevels = [&](f32 val) {
-                    // Input mapping
-                    val = (val - inBlack) / (inWhite - inBlack);
-                    val = clamp(val, 0.0f, 1.0f);
-                    // Gamma
-                    val = std::pow(val, 1.0f / gamma);
-                    // Output mapping
-                    val = val * (outWhite - outBlack) + outBlack;
-                    return val;
-                };
-
-                fr = applyLevels(fr);
-                fg = applyLevels(fg);
-                fb_color = applyLevels(fb_color);
-            }
-            break;
-        }
+        i32 firstBand = floorDiv(region.y, bandHeight);
+        i32 lastBand = floorDiv(region.y + region.h - 1, bandHeight);
+        pool.parallelFor(static_cast<u32>(lastBand - firstBand + 1), [&](u32 band) {
+            i32 bandY0 = std::max(region.y, (firstBand + static_cast<i32>(band)) * bandHeight);
+            i32 bandY1 = std::min(region.y + region.h, (firstBand + static_cast<i32>(band) + 1) * bandHeight);
+
+            // Per-band readers - neighbouring screen pixels mostly hit the same tile
+            TileReader cacheReader(cache.canvas);
+            TileReader floatReader(hasFloating ? *doc.floatingContent.pixels : cache.canvas);
+            std::vector<u32> row(region.w);
+            i32 lastDocRow = 0, lastFloatRow = 0;
+            nearestRow(view, bandY0 - 1, lastDocRow, lastFloatRow);
+            for (i32 screenY = bandY0; screenY < bandY1; ++screenY) {
+                // From 1:1 up, screen rows repeat until the next document row
+                i32 docRow = 0, floatRow = 0;
+                bool newRow = true;
+                if (repeatsRows) {
+                    nearestRow(view, screenY, docRow, floatRow);
+                    newRow = docRow != lastDocRow || floatRow != lastFloatRow;
+                }
+                if (newRow || screenY == bandY0) {
+                    resample(view, cacheReader, floatReader, region.x, screenY,
+                             static_cast<u32>(region.w), row.data());
+                }
 
-        default:
-            // Unknown adjustment type
-            break;
+                // Blend onto the framebuffer (checkerboard background)
+                fb.blendRow(region.x, screenY, row.data(), static_cast<u32>(region.w));
+
+                if (drawGrid && docRow >= 0 && docRow < static_cast<i32>(doc.height)) {
+                    if (docRow != lastDocRow && docRow > 0) {
+                        for (i32 x = gridX0; x < gridX1; ++x) {
+                            fb.blendPixel(x, screenY, Config::PIXEL_GRID_COLOR);
+                        }
+                    } else {
+                        for (i32 x : gridColumns) {
+                            fb.blendPixel(x, screenY, Config::PIXEL_GRID_COLOR);
+                        }
+                    }
+                }
+                lastDocRow = docRow;
+                lastFloatRow = floatRow;
+            }
+        });
     }
+}
 
-    // Clamp and convert back
-    fr = clamp(fr, 0.0f, 1.0f);
-    fg = clamp(fg, 0.0f, 1.0f);
-    fb_color = clamp(fb_color, 0.0f, 1.0f);
+void drawCheckerboard(Framebuffer& fb, const Rect& rect,
+                      u32 color1, u32 color2) {
+    // Use framebuffer's optimized checkerboard drawing
+    Recti intRect(static_cast<i32>(rect.x), static_cast<i32>(rect.y),
+                  static_cast<i32>(rect.w), static_cast<i32>(rect.h));
+    fb.drawCheckerboard(intRect, color1, color2, Config::CHECKER_SIZE);
+}
 
-    return Blend::pack(
-        static_cast<u8>(fr * 255.0f),
-        static_cast<u8>(fg * 255.0f),
-        static_cast<u8>(fb_color * 255.0f),
-        a
-    );
+u32 applyAdjustment(u32 pixel, const AdjustmentLayer& adj) {
+    return adj.getLut().apply(pixel);
 }
 
 void drawMarchingAnts(Framebuffer& fb, const Selection& sel,
                       const Rect& viewport, f32 zoom, const Vec2& pan, u64 time) {
     if (!sel.hasSelection) return;
 
-    // Animation phase - cycles every 200ms, 8 positions
-    u32 phase = static_cast<u32>((time / 100) % 8);
+    // Animation phase - one step every Config::MARCHING_ANTS_STEP_MS, 8 positions
+    u32 phase = static_cast<u32>((time / Config::MARCHING_ANTS_STEP_MS) % 8);
 
     // Colors for marching ants (RGBA8888 format: 0xRRGGBBAA)
     const u32 COLOR_BLACK = 0x000000FF;  // Black with full alpha
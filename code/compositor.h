@@ -8,6 +8,7 @@
 #include "blend.h"
 #include "framebuffer.h"
 #include "document.h"
+#include "composite_cache.h"
 #include "config.h"
 
 // Forward declaration
@@ -18,9 +19,35 @@ namespace Compositor {
     void compositeLayer(TiledCanvas& dst, const TiledCanvas& src,
                         BlendMode mode = BlendMode::Normal, f32 opacity = 1.0f);
 
-    // Composite all layers to a framebuffer
-    void compositeDocument(Framebuffer& fb, const Document& doc,
-                           const Rect& viewport, f32 zoom, const Vec2& pan);
+    // Unfinished brush or eraser stroke, drawn over its layer until committed
+    struct ActiveStroke {
+        const TiledCanvas* buffer = nullptr;   // nullptr when nothing is being painted
+        const PixelLayer* layer = nullptr;
+        f32 opacity = 1.0f;
+        bool eraser = false;
+    };
+
+    // The stroke the document's current tool is painting
+    ActiveStroke findActiveStroke(const Document& doc);
+
+    // Composite all layers to a framebuffer, limited to the framebuffer's active clip.
+    // cache holds the flattened layer stack between calls; the caller keeps it
+    // in step with the document's change notifications (see CompositeCache).
+    // pixelGrid outlines document pixels from Config::PIXEL_GRID_MIN_ZOOM up.
+    void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                           const Rect& viewport, f32 zoom, const Vec2& pan,
+                           bool pixelGrid = false);
+
+    // Composite all layers, evaluating layer stacks only inside the given screen regions
+    void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                           const Rect& viewport, f32 zoom, const Vec2& pan,
+                           const std::vector<Recti>& regions, bool pixelGrid = false);
+
+    // Same, with the stroke given rather than looked up from the document's tool
+    void compositeDocument(Framebuffer& fb, const Document& doc, CompositeCache& cache,
+                           const ActiveStroke& stroke,
+                           const Rect& viewport, f32 zoom, const Vec2& pan,
+                           const std::vector<Recti>& regions, bool pixelGrid = false);
 
     // Draw checkerboard pattern for transparency
     void drawCheckerboard(Framebuffer& fb, const Rect& rect,
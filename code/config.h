@@ -24,6 +24,24 @@ namespace Config {
     constexpr f32 DEFAULT_ZOOM = 1.0f;
     constexpr f32 ZOOM_STEP = 1.2f;
 
+    // Flattened-document tile cache (see composite_cache.h)
+    constexpr f32 COMPOSITE_CACHE_MIN_ZOOM = 0.5f;   // Below this the view flattens from mip levels
+    constexpr u32 COMPOSITE_CACHE_MAX_TILES = 4096;  // 64MB of flattened tiles kept beyond the ones in view
+
+    // Progressive view redraws (see canvas_renderer.h)
+    constexpr u32 VIEW_PREVIEW_FACTOR = 4;      // Preview renders every 4th pixel each way
+    constexpr u64 VIEW_PREVIEW_IDLE_MS = 150;   // Input-free time before a preview is refined
+    constexpr u64 VIEW_REFINE_BUDGET_MS = 8;    // Refinement time per frame
+    constexpr i32 VIEW_REFINE_BAND = 64;        // Rows refined per step
+
+    // Main loop pacing (see Application::run)
+    constexpr u64 FRAME_INTERVAL_MS = 16;       // Shortest time between presents (~60 Hz)
+    constexpr u64 MARCHING_ANTS_STEP_MS = 100;  // Selection outline animation step
+
+    // Partial redraws (see DirtyRegion in app_state.h)
+    constexpr u32 DIRTY_REGION_MAX_RECTS = 8;                // Rects drawn and presented per frame
+    constexpr f32 DIRTY_REGION_FULL_REDRAW_COVERAGE = 0.5f;  // Fraction of the window that redraws it all
+
     // Runtime UI scale (adjustable, default for HiDPI)
     extern f32 uiScale;
 
@@ -116,6 +134,10 @@ namespace Config {
     constexpr u32 CHECKER_COLOR1 = 0x505050FF;  // Dark square
     constexpr u32 CHECKER_COLOR2 = 0x787878FF;  // Light square
 
+    // Pixel grid over the document when zoomed in (View > Pixel Grid)
+    constexpr f32 PIXEL_GRID_MIN_ZOOM = 8.0f;    // 800%
+    constexpr u32 PIXEL_GRID_COLOR = 0x00000040;
+
     // Misc
     constexpr u32 MAX_LAYERS = 256;
     constexpr f32 SCROLL_SPEED = 20.0f;
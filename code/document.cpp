@@ -158,16 +158,10 @@ void Document::mergeDown(i32 index) {
 
     // Helper to apply adjustment to a pixel layer
     auto applyAdjustmentToLayer = [](PixelLayer* pixel, const AdjustmentLayer* adj) {
-        for (auto& [key, tile] : pixel->canvas.tiles) {
-            for (u32 py = 0; py < Config::TILE_SIZE; ++py) {
-                for (u32 px = 0; px < Config::TILE_SIZE; ++px) {
-                    u32 pix = tile->pixels[py * Config::TILE_SIZE + px];
-                    if ((pix & 0xFF) > 0) {
-                        tile->pixels[py * Config::TILE_SIZE + px] = Compositor::applyAdjustment(pix, *adj);
-                    }
-                }
-            }
-        }
+        const AdjustmentLut& lut = adj->getLut();
+        pixel->canvas.forEachTileForWrite([&](i32, i32, Tile& tile) {
+            lut.applyRow(tile.pixels, Config::TILE_SIZE * Config::TILE_SIZE);
+        });
     };
 
     // Case 1: Upper is adjustment layer - apply to lower
@@ -206,19 +200,9 @@ void Document::mergeDown(i32 index) {
 
             i32 offsetX = static_cast<i32>(upper->transform.position.x);
             i32 offsetY = static_cast<i32>(upper->transform.position.y);
-
-            upperText->rasterizedCache.forEachPixel([&](u32 x, u32 y, u32 pix) {
-                if ((pix & 0xFF) > 0) {
-                    i32 destX = static_cast<i32>(x) + offsetX;
-                    i32 destY = static_cast<i32>(y) + offsetY;
-                    if (destX >= 0 && destY >= 0 &&
-                        destX < static_cast<i32>(width) && destY < static_cast<i32>(height)) {
-                        u32 existing = lowerPixel->canvas.getPixel(destX, destY);
-                        u32 blended = Blend::blend(existing, pix, upper->blend, upper->opacity);
-                        lowerPixel->canvas.setPixel(destX, destY, blended);
-                    }
-                }
-            });
+            Recti bounds(0, 0, width, height);
+            lowerPixel->canvas.blendCanvas(upperText->rasterizedCache, upper->blend, upper->opacity,
+                                           offsetX, offsetY, &bounds);
         }
         else if (lower->isTextLayer()) {
             // Both are text - rasterize lower, then composite upper
@@ -227,19 +211,9 @@ void Document::mergeDown(i32 index) {
 
             i32 offsetX = static_cast<i32>(upper->transform.position.x);
             i32 offsetY = static_cast<i32>(upper->transform.position.y);
-
-            upperText->rasterizedCache.forEachPixel([&](u32 x, u32 y, u32 pix) {
-                if ((pix & 0xFF) > 0) {
-                    i32 destX = static_cast<i32>(x) + offsetX;
-                    i32 destY = static_cast<i32>(y) + offsetY;
-                    if (destX >= 0 && destY >= 0 &&
-                        destX < static_cast<i32>(width) && destY < static_cast<i32>(height)) {
-                        u32 existing = rasterized->canvas.getPixel(destX, destY);
-                        u32 blended = Blend::blend(existing, pix, upper->blend, upper->opacity);
-                        rasterized->canvas.setPixel(destX, destY, blended);
-                    }
-                }
-            });
+            Recti bounds(0, 0, width, height);
+            rasterized->canvas.blendCanvas(upperText->rasterizedCache, upper->blend, upper->opacity,
+                                           offsetX, offsetY, &bounds);
 
             layers[index - 1] = std::move(rasterized);
         }
@@ -277,7 +251,9 @@ void Document::mergeVisible() {
     merged->name = "Merged";
 
     // Composite all visible layers (bottom to top)
-    for (const auto& layer : layers) {
+    std::vector<const AdjustmentLut*> adjustments = fuseAdjustments(layers);
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const auto& layer = layers[i];
         if (!layer->visible) continue;
 
         if (layer->isPixelLayer()) {
@@ -294,35 +270,17 @@ void Document::mergeVisible() {
             // Account for layer position
             i32 offsetX = static_cast<i32>(layer->transform.position.x);
             i32 offsetY = static_cast<i32>(layer->transform.position.y);
-
-            text->rasterizedCache.forEachPixel([&](u32 x, u32 y, u32 pixel) {
-                if ((pixel & 0xFF) > 0) {
-                    i32 destX = static_cast<i32>(x) + offsetX;
-                    i32 destY = static_cast<i32>(y) + offsetY;
-                    if (destX >= 0 && destY >= 0 &&
-                        destX < static_cast<i32>(width) && destY < static_cast<i32>(height)) {
-                        u32 existing = merged->canvas.getPixel(destX, destY);
-                        u32 blended = Blend::blend(existing, pixel, layer->blend, layer->opacity);
-                        merged->canvas.setPixel(destX, destY, blended);
-                    }
-                }
-            });
+            Recti bounds(0, 0, width, height);
+            merged->canvas.blendCanvas(text->rasterizedCache, layer->blend, layer->opacity,
+                                       offsetX, offsetY, &bounds);
         }
-        else if (layer->isAdjustmentLayer()) {
-            // Apply adjustment to all existing pixels in merged canvas
-            const AdjustmentLayer* adj = static_cast<const AdjustmentLayer*>(layer.get());
-
-            // Iterate all tiles and apply adjustment
-            for (auto& [key, tile] : merged->canvas.tiles) {
-                for (u32 py = 0; py < Config::TILE_SIZE; ++py) {
-                    for (u32 px = 0; px < Config::TILE_SIZE; ++px) {
-                        u32 pixel = tile->pixels[py * Config::TILE_SIZE + px];
-                        if ((pixel & 0xFF) > 0) {
-                            tile->pixels[py * Config::TILE_SIZE + px] = Compositor::applyAdjustment(pixel, *adj);
-                        }
-                    }
-                }
-            }
+        else if (layer->isAdjustmentLayer() && adjustments[i]) {
+            // Apply the adjustment (or the run of them starting here) to all
+            // existing pixels in merged canvas
+            const AdjustmentLut& lut = *adjustments[i];
+            merged->canvas.forEachTileForWrite([&](i32, i32, Tile& tile) {
+                lut.applyRow(tile.pixels, Config::TILE_SIZE * Config::TILE_SIZE);
+            });
         }
     }
 
@@ -398,13 +356,10 @@ void Document::rasterizeLayer(i32 index) {
         i32 offsetX = static_cast<i32>(text->transform.position.x);
         i32 offsetY = static_cast<i32>(text->transform.position.y);
 
-        for (const auto& [key, tile] : text->rasterizedCache.tiles) {
-            i32 tileX, tileY;
-            extractTileCoords(key, tileX, tileY);
-
+        text->rasterizedCache.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
             for (u32 py = 0; py < Config::TILE_SIZE; ++py) {
                 for (u32 px = 0; px < Config::TILE_SIZE; ++px) {
-                    u32 color = tile->pixels[py * Config::TILE_SIZE + px];
+                    u32 color = tile.pixels[py * Config::TILE_SIZE + px];
                     if ((color & 0xFF) > 0) {  // Has alpha
                         i32 destX = tileX * Config::TILE_SIZE + px + offsetX;
                         i32 destY = tileY * Config::TILE_SIZE + py + offsetY;
@@ -414,7 +369,7 @@ void Document::rasterizeLayer(i32 index) {
                     }
                 }
             }
-        }
+        });
 
         // Clear transform since we've baked the position in
         pixel->transform = Transform();
@@ -484,28 +439,22 @@ void Document::rasterizePixelLayerTransform(i32 layerIndex) {
     f32 offsetX = minX;
     f32 offsetY = minY;
 
-    // Rasterize: for each destination pixel, sample from source
+    // Rasterize a row at a time, sampling the source bilinearly
+    AffineSampler sampler(pixelLayer->canvas, invMat, pixelLayer->canvas.getBounds());
+    TileWriter writer(newCanvas);
+    std::vector<u32> row(newW);
     for (i32 dy = 0; dy < newH; dy++) {
+        sampler.sampleRow(offsetX, static_cast<f32>(dy) + offsetY, static_cast<u32>(newW), row.data());
         for (i32 dx = 0; dx < newW; dx++) {
-            // Destination in document space
-            f32 docX = static_cast<f32>(dx) + offsetX;
-            f32 docY = static_cast<f32>(dy) + offsetY;
-
-            // Transform to source coordinates
-            Vec2 srcCoord = invMat.transform(Vec2(docX, docY));
-
-            // Sample with bilinear interpolation
-            u32 pixel = Sampler::sample(pixelLayer->canvas, srcCoord.x, srcCoord.y,
-                                        SampleMode::Bilinear);
-
-            if (pixel & 0xFF) {  // Has alpha
-                newCanvas.setPixel(dx, dy, pixel);
+            if (row[dx] & 0xFF) {  // Has alpha
+                writer.setPixel(dx, dy, row[dx]);
             }
         }
     }
 
     // Replace canvas
     pixelLayer->canvas = std::move(newCanvas);
+    pixelLayer->canvas.compactSolidTiles();
 
     // Reset transform, keeping position as offset
     xform.position.x = offsetX;
@@ -549,6 +498,7 @@ void Document::setTool(std::unique_ptr<Tool> tool) {
                     }
                 }
             }
+            layer->canvas.touch();
 
             // Move the selection mask to match
             selection.offset(offsetX, offsetY);
@@ -642,6 +592,7 @@ void Document::resizeCanvas(u32 newWidth, u32 newHeight, i32 anchorX, i32 anchor
                 }
 
                 pixelLayer->canvas = std::move(newCanvas);
+                pixelLayer->canvas.compactSolidTiles();
             }
             else if (layer->isTextLayer()) {
                 // Scale text layer transform (position and scale), not font size
@@ -696,6 +647,7 @@ void Document::resizeCanvas(u32 newWidth, u32 newHeight, i32 anchorX, i32 anchor
             });
 
             pixelLayer->canvas = std::move(newCanvas);
+            pixelLayer->canvas.compactSolidTiles();
         }
         else if (layer->isTextLayer()) {
             // Adjust text layer position
@@ -759,17 +711,45 @@ void Document::copy() {
             }
         }
     } else {
-        // Copy entire layer
+        // Copy entire layer (tiles are shared until either side is edited)
         clipboard.width = layer->canvas.width;
         clipboard.height = layer->canvas.height;
-        clipboard.pixels = std::make_unique<TiledCanvas>(clipboard.width, clipboard.height);
-
-        layer->canvas.forEachPixel([&](u32 x, u32 y, u32 pixel) {
-            clipboard.pixels->setPixel(x, y, pixel);
-        });
+        clipboard.pixels = layer->canvas.clone();
     }
 }
 
+// Copy clipboard pixels into a layer canvas at an offset, dropping anything
+// outside the canvas. When the offset is a whole number of tiles, tiles that
+// land fully inside are shared rather than copied pixel by pixel.
+static void pasteClipboardPixels(const TiledCanvas& src, TiledCanvas& dst, i32 offsetX, i32 offsetY) {
+    const i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    const i32 dstWidth = static_cast<i32>(dst.width);
+    const i32 dstHeight = static_cast<i32>(dst.height);
+    bool aligned = floorMod(offsetX, tileSize) == 0 && floorMod(offsetY, tileSize) == 0;
+
+    src.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
+        i32 destX = tileX * tileSize + offsetX;
+        i32 destY = tileY * tileSize + offsetY;
+
+        if (aligned && destX >= 0 && destY >= 0 &&
+            destX + tileSize <= dstWidth && destY + tileSize <= dstHeight) {
+            dst.setTile(destX / tileSize, destY / tileSize, src.shareTile(tileX, tileY));
+            return;
+        }
+
+        for (i32 ly = 0; ly < tileSize; ++ly) {
+            i32 y = destY + ly;
+            if (y < 0 || y >= dstHeight) continue;
+            for (i32 lx = 0; lx < tileSize; ++lx) {
+                i32 x = destX + lx;
+                if (x < 0 || x >= dstWidth) continue;
+                dst.setPixel(x, y, tile.getPixel(static_cast<u32>(lx), static_cast<u32>(ly)));
+            }
+        }
+    });
+    dst.touch();
+}
+
 void Document::paste() {
     AppState& state = getAppState();
     Clipboard& clipboard = state.clipboard;
@@ -785,15 +765,7 @@ void Document::paste() {
     i32 offsetY = (static_cast<i32>(height) - static_cast<i32>(clipboard.height)) / 2;
 
     // Copy clipboard pixels to new layer
-    clipboard.pixels->forEachPixel([&](u32 x, u32 y, u32 pixel) {
-        i32 destX = static_cast<i32>(x) + offsetX;
-        i32 destY = static_cast<i32>(y) + offsetY;
-
-        if (destX >= 0 && destX < static_cast<i32>(width) &&
-            destY >= 0 && destY < static_cast<i32>(height)) {
-            newLayer->canvas.setPixel(destX, destY, pixel);
-        }
-    });
+    pasteClipboardPixels(*clipboard.pixels, newLayer->canvas, offsetX, offsetY);
 
     // Add layer above active layer and make it active
     i32 newIndex = activeLayerIndex + 1;
@@ -824,15 +796,7 @@ void Document::pasteInPlace() {
     newLayer->name = "Pasted";
 
     // Paste at original position
-    clipboard.pixels->forEachPixel([&](u32 x, u32 y, u32 pixel) {
-        i32 destX = clipboard.originX + static_cast<i32>(x);
-        i32 destY = clipboard.originY + static_cast<i32>(y);
-
-        if (destX >= 0 && destX < static_cast<i32>(width) &&
-            destY >= 0 && destY < static_cast<i32>(height)) {
-            newLayer->canvas.setPixel(destX, destY, pixel);
-        }
-    });
+    pasteClipboardPixels(*clipboard.pixels, newLayer->canvas, clipboard.originX, clipboard.originY);
 
     // Add layer above active layer and make it active
     i32 newIndex = activeLayerIndex + 1;
@@ -875,6 +839,7 @@ void Document::deleteSelection() {
     }
 
     layer->canvas.pruneEmptyTiles();
+    layer->canvas.touch();
     notifyChanged(selection.bounds.toRect());
 }
 
@@ -908,6 +873,8 @@ void Document::fill(u32 color) {
                 }
             }
         }
+        layer->canvas.compactSolidTiles();
+        layer->canvas.touch();
         notifyChanged(selection.bounds.toRect());
     } else {
         // Fill entire layer
@@ -928,6 +895,7 @@ void Document::flipHorizontal() {
             });
 
             pixelLayer->canvas = std::move(flipped);
+            pixelLayer->canvas.compactSolidTiles();
         }
         else if (layer->isTextLayer()) {
             // Flip text layer position and apply horizontal flip via scale
@@ -966,6 +934,7 @@ void Document::flipVertical() {
             });
 
             pixelLayer->canvas = std::move(flipped);
+            pixelLayer->canvas.compactSolidTiles();
         }
         else if (layer->isTextLayer()) {
             // Flip text layer position and apply vertical flip via scale
@@ -1012,6 +981,7 @@ void Document::rotateLeft() {
             });
 
             pixelLayer->canvas = std::move(rotated);
+            pixelLayer->canvas.compactSolidTiles();
         }
         else if (layer->isTextLayer()) {
             // Rotate text layer position and orientation
@@ -1063,6 +1033,7 @@ void Document::rotateRight() {
             });
 
             pixelLayer->canvas = std::move(rotated);
+            pixelLayer->canvas.compactSolidTiles();
         }
         else if (layer->isTextLayer()) {
             // Rotate text layer position and orientation
@@ -1134,6 +1105,7 @@ void Document::rotateLayerLeft() {
     });
 
     layer->canvas = std::move(rotated);
+    layer->canvas.compactSolidTiles();
 
     // Calculate new content bounds after rotation
     // Old content at (contentBounds.x, contentBounds.y) with size (contentBounds.w, contentBounds.h)
@@ -1191,6 +1163,7 @@ void Document::rotateLayerRight() {
     });
 
     layer->canvas = std::move(rotated);
+    layer->canvas.compactSolidTiles();
 
     // Calculate new content bounds after rotation
     // Old content at (contentBounds.x, contentBounds.y) with size (contentBounds.w, contentBounds.h)
@@ -1239,6 +1212,7 @@ void Document::flipLayerHorizontal() {
     });
 
     layer->canvas = std::move(flipped);
+    layer->canvas.compactSolidTiles();
 
     // After horizontal flip, content x position changes
     // New content x = canvasW - contentBounds.x - contentBounds.w
@@ -1281,6 +1255,7 @@ void Document::flipLayerVertical() {
     });
 
     layer->canvas = std::move(flipped);
+    layer->canvas.compactSolidTiles();
 
     // After vertical flip, content y position changes
     // New content y = canvasH - contentBounds.y - contentBounds.h
@@ -1408,8 +1383,8 @@ void Document::captureOriginalTile(i32 layerIndex, u64 tileKey) {
 
     PixelLayer* pixelLayer = static_cast<PixelLayer*>(layer);
 
-    // Clone the tile (or store nullptr if it doesn't exist yet)
-    std::unique_ptr<Tile> tileCopy = pixelLayer->canvas.cloneTileByKey(tileKey);
+    // Share the tile (or store nullptr if it doesn't exist yet)
+    TileRef tileCopy = pixelLayer->canvas.cloneTileByKey(tileKey);
     pendingUndoStep->tileDelta->originalTiles[tileKey] = std::move(tileCopy);
 }
 
@@ -1441,7 +1416,7 @@ void Document::commitUndo() {
 
             // Capture current (new) state for all tiles we tracked
             for (const auto& [key, originalTile] : pendingUndoStep->tileDelta->originalTiles) {
-                std::unique_ptr<Tile> newTile = pixelLayer->canvas.cloneTileByKey(key);
+                TileRef newTile = pixelLayer->canvas.cloneTileByKey(key);
                 pendingUndoStep->tileDelta->newTiles[key] = std::move(newTile);
             }
         }
@@ -1502,20 +1477,9 @@ void Document::undo() {
 
             PixelLayer* pixelLayer = static_cast<PixelLayer*>(layer);
 
-            // Swap original tiles back into the canvas
-            // The canvas will return the current tiles (which we stored as newTiles already)
-            for (auto& [key, originalTile] : step.tileDelta->originalTiles) {
-                auto it = pixelLayer->canvas.tiles.find(key);
-                if (it != pixelLayer->canvas.tiles.end()) {
-                    if (originalTile) {
-                        it->second = std::move(originalTile);
-                    } else {
-                        pixelLayer->canvas.tiles.erase(it);
-                    }
-                } else if (originalTile) {
-                    pixelLayer->canvas.tiles[key] = std::move(originalTile);
-                }
-            }
+            // Swap original tiles back into the canvas; the canvas returns the
+            // current tiles, which become the redo state
+            step.tileDelta->newTiles = pixelLayer->canvas.swapTiles(step.tileDelta->originalTiles);
 
             // Move the new tiles back to originalTiles for redo
             std::swap(step.tileDelta->originalTiles, step.tileDelta->newTiles);
@@ -1578,18 +1542,7 @@ void Document::redo() {
             PixelLayer* pixelLayer = static_cast<PixelLayer*>(layer);
 
             // Swap tiles back (same logic as undo - originalTiles now has the "new" state)
-            for (auto& [key, tile] : step.tileDelta->originalTiles) {
-                auto it = pixelLayer->canvas.tiles.find(key);
-                if (it != pixelLayer->canvas.tiles.end()) {
-                    if (tile) {
-                        it->second = std::move(tile);
-                    } else {
-                        pixelLayer->canvas.tiles.erase(it);
-                    }
-                } else if (tile) {
-                    pixelLayer->canvas.tiles[key] = std::move(tile);
-                }
-            }
+            step.tileDelta->newTiles = pixelLayer->canvas.swapTiles(step.tileDelta->originalTiles);
 
             // Swap back for future undo
             std::swap(step.tileDelta->originalTiles, step.tileDelta->newTiles);
@@ -78,6 +78,7 @@ void EraserTool::onMouseDown(Document& doc, const ToolEvent& e) {
         doc.captureOriginalTile(doc.activeLayerIndex, makeTileKey(tileX, tileY));
 
         BrushRenderer::pencilErase(layer->canvas, px, py, effectiveFlow, sel, selTransform);
+        layer->canvas.touch();
         doc.notifyChanged(Rect(e.position.x - 1, e.position.y - 1, 3, 3));
     } else {
         // Create stroke buffer for this stroke
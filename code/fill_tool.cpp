@@ -50,6 +50,9 @@ void FillTool::onMouseDown(Document& doc, const ToolEvent& e) {
                               sel, layerToDoc, doc.width, doc.height);
     }
 
+    // Flat fills often cover whole tiles
+    layer->canvas.compactSolidTiles(fullBounds);
+
     // Commit undo
     doc.commitUndo();
 
@@ -97,6 +100,7 @@ void FillTool::expandLayerToDocument(PixelLayer* layer, u32 docWidth, u32 docHei
 
     // Replace canvas and update position
     layer->canvas = std::move(newCanvas);
+    layer->canvas.compactSolidTiles();
     layer->transform.position.x = static_cast<f32>(minX);
     layer->transform.position.y = static_cast<f32>(minY);
 }
@@ -135,6 +139,8 @@ void FillTool::floodFill(TiledCanvas& canvas, i32 startX, i32 startY,
     queue.push({startX, startY});
     visited[startY * w + startX] = true;
 
+    TileWriter writer(canvas);
+
     while (!queue.empty()) {
         auto [x, y] = queue.front();
         queue.pop();
@@ -151,10 +157,10 @@ void FillTool::floodFill(TiledCanvas& canvas, i32 startX, i32 startY,
             if (docX < 0 || docY < 0 || docX >= docWidth || docY >= docHeight) continue;
         }
 
-        u32 currentColor = canvas.getPixel(x, y);
+        u32 currentColor = writer.getPixel(x, y);
         if (colorDifference(currentColor, targetColor) > tolerance) continue;
 
-        canvas.setPixel(x, y, fillColor);
+        writer.setPixel(x, y, fillColor);
 
         // Check 4-connected neighbors
         const i32 dx[] = {-1, 1, 0, 0};
@@ -178,7 +184,7 @@ void FillTool::floodFill(TiledCanvas& canvas, i32 startX, i32 startY,
                         if (ndocX < 0 || ndocY < 0 || ndocX >= docWidth || ndocY >= docHeight) continue;
                     }
 
-                    u32 neighborColor = canvas.getPixel(nx, ny);
+                    u32 neighborColor = writer.getPixel(nx, ny);
                     if (colorDifference(neighborColor, targetColor) <= tolerance) {
                         visited[idx] = true;
                         queue.push({nx, ny});
@@ -193,6 +199,7 @@ void FillTool::globalFill(TiledCanvas& canvas, u32 targetColor, u32 fillColor, f
                           const Selection* sel,
                           i32 layerOffsetX, i32 layerOffsetY,
                           i32 docWidth, i32 docHeight) {
+    TileWriter writer(canvas);
     for (u32 y = 0; y < canvas.height; ++y) {
         for (u32 x = 0; x < canvas.width; ++x) {
             // Convert to document coords
@@ -207,9 +214,9 @@ void FillTool::globalFill(TiledCanvas& canvas, u32 targetColor, u32 fillColor, f
                 if (docX < 0 || docY < 0 || docX >= docWidth || docY >= docHeight) continue;
             }
 
-            u32 currentColor = canvas.getPixel(x, y);
+            u32 currentColor = writer.getPixel(x, y);
             if (colorDifference(currentColor, targetColor) <= tolerance) {
-                canvas.setPixel(x, y, fillColor);
+                writer.setPixel(x, y, fillColor);
             }
         }
     }
@@ -236,6 +243,8 @@ void FillTool::floodFillTransformed(TiledCanvas& canvas, i32 startX, i32 startY,
     queue.push({startX, startY});
     visited.insert(packCoord(startX, startY));
 
+    TileWriter writer(canvas);
+
     while (!queue.empty()) {
         auto [x, y] = queue.front();
         queue.pop();
@@ -251,10 +260,10 @@ void FillTool::floodFillTransformed(TiledCanvas& canvas, i32 startX, i32 startY,
         // Check selection bounds if active
         if (sel && !sel->isSelected(docX, docY)) continue;
 
-        u32 currentColor = canvas.getPixel(x, y);
+        u32 currentColor = writer.getPixel(x, y);
         if (colorDifference(currentColor, targetColor) > tolerance) continue;
 
-        canvas.setPixel(x, y, fillColor);
+        writer.setPixel(x, y, fillColor);
 
         // Check 4-connected neighbors
         const i32 dx[] = {-1, 1, 0, 0};
@@ -278,7 +287,7 @@ void FillTool::floodFillTransformed(TiledCanvas& canvas, i32 startX, i32 startY,
             // Check selection for neighbor
             if (sel && !sel->isSelected(nDocX, nDocY)) continue;
 
-            u32 neighborColor = canvas.getPixel(nx, ny);
+            u32 neighborColor = writer.getPixel(nx, ny);
             if (colorDifference(neighborColor, targetColor) <= tolerance) {
                 visited.insert(key);
                 queue.push({nx, ny});
@@ -292,6 +301,7 @@ void FillTool::globalFillTransformed(TiledCanvas& canvas, u32 targetColor, u32 f
                                       const Matrix3x2& layerToDoc,
                                       i32 docWidth, i32 docHeight) {
     // Iterate over existing tiles and fill matching pixels
+    TileWriter writer(canvas);
     canvas.forEachPixel([&](u32 x, u32 y, u32 pixel) {
         // Transform to document coords
         Vec2 docPos = layerToDoc.transform(Vec2(static_cast<f32>(x), static_cast<f32>(y)));
@@ -305,7 +315,7 @@ void FillTool::globalFillTransformed(TiledCanvas& canvas, u32 targetColor, u32 f
         if (sel && !sel->isSelected(docX, docY)) return;
 
         if (colorDifference(pixel, targetColor) <= tolerance) {
-            canvas.setPixel(x, y, fillColor);
+            writer.setPixel(x, y, fillColor);
         }
     });
 }
@@ -32,31 +32,11 @@ bool Framebuffer::isClipped(i32 x, i32 y) const {
 void Framebuffer::resize(u32 w, u32 h) {
     width = w;
     height = h;
-#ifdef __EMSCRIPTEN__
-    pixels.resize(w * h * 4);
-#else
     pixels.resize(w * h);
-#endif
 }
 
 void Framebuffer::clear(u32 color) {
-#ifdef __EMSCRIPTEN__
-    // WASM: Store in canvas RGBA byte order
-    u8 r = (color >> 24) & 0xFF;
-    u8 g = (color >> 16) & 0xFF;
-    u8 b = (color >> 8) & 0xFF;
-    u8 a = color & 0xFF;
-    size_t count = width * height;
-    for (size_t i = 0; i < count; ++i) {
-        size_t idx = i * 4;
-        pixels[idx + 0] = r;
-        pixels[idx + 1] = g;
-        pixels[idx + 2] = b;
-        pixels[idx + 3] = a;
-    }
-#else
-    std::fill(pixels.begin(), pixels.end(), color);
-#endif
+    std::fill(pixels.begin(), pixels.end(), PixelFormat::fromRGBA(color));
 }
 
 void Framebuffer::clearRect(const Recti& rect, u32 color) {
@@ -74,42 +54,19 @@ void Framebuffer::clearRect(const Recti& rect, u32 color) {
         y1 = std::min(y1, clip.y + clip.h);
     }
 
-#ifdef __EMSCRIPTEN__
-    u8 r = (color >> 24) & 0xFF;
-    u8 g = (color >> 16) & 0xFF;
-    u8 b = (color >> 8) & 0xFF;
-    u8 a = color & 0xFF;
-    for (i32 y = y0; y < y1; ++y) {
-        for (i32 x = x0; x < x1; ++x) {
-            size_t idx = (y * width + x) * 4;
-            pixels[idx + 0] = r;
-            pixels[idx + 1] = g;
-            pixels[idx + 2] = b;
-            pixels[idx + 3] = a;
-        }
-    }
-#else
+    const u32 native = PixelFormat::fromRGBA(color);
     for (i32 y = y0; y < y1; ++y) {
         for (i32 x = x0; x < x1; ++x) {
-            pixels[y * width + x] = color;
+            pixels[y * width + x] = native;
         }
     }
-#endif
 }
 
 u32 Framebuffer::getPixel(i32 x, i32 y) const {
     if (x < 0 || y < 0 || x >= static_cast<i32>(width) || y >= static_cast<i32>(height)) {
         return 0;
     }
-#ifdef __EMSCRIPTEN__
-    size_t idx = (y * width + x) * 4;
-    return (static_cast<u32>(pixels[idx + 0]) << 24) |
-           (static_cast<u32>(pixels[idx + 1]) << 16) |
-           (static_cast<u32>(pixels[idx + 2]) << 8) |
-           static_cast<u32>(pixels[idx + 3]);
-#else
-    return pixels[y * width + x];
-#endif
+    return PixelFormat::toRGBA(pixels[y * width + x]);
 }
 
 void Framebuffer::setPixel(i32 x, i32 y, u32 color) {
@@ -117,15 +74,7 @@ void Framebuffer::setPixel(i32 x, i32 y, u32 color) {
         return;
     }
     if (isClipped(x, y)) return;
-#ifdef __EMSCRIPTEN__
-    size_t idx = (y * width + x) * 4;
-    pixels[idx + 0] = (color >> 24) & 0xFF;
-    pixels[idx + 1] = (color >> 16) & 0xFF;
-    pixels[idx + 2] = (color >> 8) & 0xFF;
-    pixels[idx + 3] = color & 0xFF;
-#else
-    pixels[y * width + x] = color;
-#endif
+    pixels[y * width + x] = PixelFormat::fromRGBA(color);
 }
 
 void Framebuffer::blendPixel(i32 x, i32 y, u32 color) {
@@ -133,21 +82,24 @@ void Framebuffer::blendPixel(i32 x, i32 y, u32 color) {
         return;
     }
     if (isClipped(x, y)) return;
-#ifdef __EMSCRIPTEN__
-    size_t idx = (y * width + x) * 4;
-    u32 dst = (static_cast<u32>(pixels[idx + 0]) << 24) |
-              (static_cast<u32>(pixels[idx + 1]) << 16) |
-              (static_cast<u32>(pixels[idx + 2]) << 8) |
-              static_cast<u32>(pixels[idx + 3]);
-    u32 result = Blend::alphaBlend(dst, color);
-    pixels[idx + 0] = (result >> 24) & 0xFF;
-    pixels[idx + 1] = (result >> 16) & 0xFF;
-    pixels[idx + 2] = (result >> 8) & 0xFF;
-    pixels[idx + 3] = result & 0xFF;
-#else
-    u32 dst = pixels[y * width + x];
-    pixels[y * width + x] = Blend::alphaBlend(dst, color);
-#endif
+    u32& dst = pixels[y * width + x];
+    dst = PixelFormat::fromRGBA(Blend::alphaBlend(PixelFormat::toRGBA(dst), color));
+}
+
+void Framebuffer::blendRow(i32 x, i32 y, const u32* colors, u32 count) {
+    if (y < 0 || y >= static_cast<i32>(height)) return;
+    i32 x0 = std::max(0, x);
+    i32 x1 = std::min(static_cast<i32>(width), x + static_cast<i32>(count));
+    if (!clipStack.empty()) {
+        const Recti& clip = clipStack.back();
+        if (y < clip.y || y >= clip.y + clip.h) return;
+        x0 = std::max(x0, clip.x);
+        x1 = std::min(x1, clip.x + clip.w);
+    }
+    if (x0 >= x1) return;
+    colors += x0 - x;
+
+    Blend::alphaBlendSpanNative(&pixels[y * width + x0], colors, static_cast<u32>(x1 - x0));
 }
 
 void Framebuffer::fillRect(const Recti& rect, u32 color) {
@@ -166,51 +118,21 @@ void Framebuffer::fillRect(const Recti& rect, u32 color) {
     }
 
     u8 alpha = color & 0xFF;
-#ifdef __EMSCRIPTEN__
-    u8 r = (color >> 24) & 0xFF;
-    u8 g = (color >> 16) & 0xFF;
-    u8 b = (color >> 8) & 0xFF;
     if (alpha == 255) {
+        const u32 native = PixelFormat::fromRGBA(color);
         for (i32 y = y0; y < y1; ++y) {
             for (i32 x = x0; x < x1; ++x) {
-                size_t idx = (y * width + x) * 4;
-                pixels[idx + 0] = r;
-                pixels[idx + 1] = g;
-                pixels[idx + 2] = b;
-                pixels[idx + 3] = alpha;
+                pixels[y * width + x] = native;
             }
         }
     } else if (alpha > 0) {
         for (i32 y = y0; y < y1; ++y) {
             for (i32 x = x0; x < x1; ++x) {
-                size_t idx = (y * width + x) * 4;
-                u32 dst = (static_cast<u32>(pixels[idx + 0]) << 24) |
-                          (static_cast<u32>(pixels[idx + 1]) << 16) |
-                          (static_cast<u32>(pixels[idx + 2]) << 8) |
-                          static_cast<u32>(pixels[idx + 3]);
-                u32 result = Blend::alphaBlend(dst, color);
-                pixels[idx + 0] = (result >> 24) & 0xFF;
-                pixels[idx + 1] = (result >> 16) & 0xFF;
-                pixels[idx + 2] = (result >> 8) & 0xFF;
-                pixels[idx + 3] = result & 0xFF;
+                u32& dst = pixels[y * width + x];
+                dst = PixelFormat::fromRGBA(Blend::alphaBlend(PixelFormat::toRGBA(dst), color));
             }
         }
     }
-#else
-    if (alpha == 255) {
-        for (i32 y = y0; y < y1; ++y) {
-            for (i32 x = x0; x < x1; ++x) {
-                pixels[y * width + x] = color;
-            }
-        }
-    } else if (alpha > 0) {
-        for (i32 y = y0; y < y1; ++y) {
-            for (i32 x = x0; x < x1; ++x) {
-                pixels[y * width + x] = Blend::alphaBlend(pixels[y * width + x], color);
-            }
-        }
-    }
-#endif
 }
 
 void Framebuffer::fillRect(i32 x, i32 y, i32 w, i32 h, u32 color) {
@@ -327,43 +249,17 @@ void Framebuffer::drawHorizontalLine(i32 x0, i32 x1, i32 y, u32 color) {
     if (x0 > x1) return;
 
     u8 alpha = color & 0xFF;
-#ifdef __EMSCRIPTEN__
-    u8 r = (color >> 24) & 0xFF;
-    u8 g = (color >> 16) & 0xFF;
-    u8 b = (color >> 8) & 0xFF;
     if (alpha == 255) {
+        const u32 native = PixelFormat::fromRGBA(color);
         for (i32 x = x0; x <= x1; ++x) {
-            size_t idx = (y * width + x) * 4;
-            pixels[idx + 0] = r;
-            pixels[idx + 1] = g;
-            pixels[idx + 2] = b;
-            pixels[idx + 3] = alpha;
+            pixels[y * width + x] = native;
         }
     } else if (alpha > 0) {
         for (i32 x = x0; x <= x1; ++x) {
-            size_t idx = (y * width + x) * 4;
-            u32 dst = (static_cast<u32>(pixels[idx + 0]) << 24) |
-                      (static_cast<u32>(pixels[idx + 1]) << 16) |
-                      (static_cast<u32>(pixels[idx + 2]) << 8) |
-                      static_cast<u32>(pixels[idx + 3]);
-            u32 result = Blend::alphaBlend(dst, color);
-            pixels[idx + 0] = (result >> 24) & 0xFF;
-            pixels[idx + 1] = (result >> 16) & 0xFF;
-            pixels[idx + 2] = (result >> 8) & 0xFF;
-            pixels[idx + 3] = result & 0xFF;
+            u32& dst = pixels[y * width + x];
+            dst = PixelFormat::fromRGBA(Blend::alphaBlend(PixelFormat::toRGBA(dst), color));
         }
     }
-#else
-    if (alpha == 255) {
-        for (i32 x = x0; x <= x1; ++x) {
-            pixels[y * width + x] = color;
-        }
-    } else if (alpha > 0) {
-        for (i32 x = x0; x <= x1; ++x) {
-            pixels[y * width + x] = Blend::alphaBlend(pixels[y * width + x], color);
-        }
-    }
-#endif
 }
 
 void Framebuffer::drawVerticalLine(i32 x, i32 y0, i32 y1, u32 color) {
@@ -383,46 +279,21 @@ void Framebuffer::drawVerticalLine(i32 x, i32 y0, i32 y1, u32 color) {
     if (y0 > y1) return;
 
     u8 alpha = color & 0xFF;
-#ifdef __EMSCRIPTEN__
-    u8 r = (color >> 24) & 0xFF;
-    u8 g = (color >> 16) & 0xFF;
-    u8 b = (color >> 8) & 0xFF;
     if (alpha == 255) {
+        const u32 native = PixelFormat::fromRGBA(color);
         for (i32 y = y0; y <= y1; ++y) {
-            size_t idx = (y * width + x) * 4;
-            pixels[idx + 0] = r;
-            pixels[idx + 1] = g;
-            pixels[idx + 2] = b;
-            pixels[idx + 3] = alpha;
+            pixels[y * width + x] = native;
         }
     } else if (alpha > 0) {
         for (i32 y = y0; y <= y1; ++y) {
-            size_t idx = (y * width + x) * 4;
-            u32 dst = (static_cast<u32>(pixels[idx + 0]) << 24) |
-                      (static_cast<u32>(pixels[idx + 1]) << 16) |
-                      (static_cast<u32>(pixels[idx + 2]) << 8) |
-                      static_cast<u32>(pixels[idx + 3]);
-            u32 result = Blend::alphaBlend(dst, color);
-            pixels[idx + 0] = (result >> 24) & 0xFF;
-            pixels[idx + 1] = (result >> 16) & 0xFF;
-            pixels[idx + 2] = (result >> 8) & 0xFF;
-            pixels[idx + 3] = result & 0xFF;
+            u32& dst = pixels[y * width + x];
+            dst = PixelFormat::fromRGBA(Blend::alphaBlend(PixelFormat::toRGBA(dst), color));
         }
     }
-#else
-    if (alpha == 255) {
-        for (i32 y = y0; y <= y1; ++y) {
-            pixels[y * width + x] = color;
-        }
-    } else if (alpha > 0) {
-        for (i32 y = y0; y <= y1; ++y) {
-            pixels[y * width + x] = Blend::alphaBlend(pixels[y * width + x], color);
-        }
-    }
-#endif
 }
 
-void Framebuffer::drawCheckerboard(const Recti& rect, u32 color1, u32 color2, u32 size) {
+void Framebuffer::drawCheckerboard(const Recti& rect, u32 color1, u32 color2, u32 size,
+                                   i32 originX, i32 originY) {
     i32 x0 = std::max(0, rect.x);
     i32 y0 = std::max(0, rect.y);
     i32 x1 = std::min(static_cast<i32>(width), rect.x + rect.w);
@@ -439,52 +310,21 @@ void Framebuffer::drawCheckerboard(const Recti& rect, u32 color1, u32 color2, u3
 
     i32 checkerSize = static_cast<i32>(size);
 
-#ifdef __EMSCRIPTEN__
-    // WASM: Store in canvas RGBA byte order with row-wise optimization
-    u8 r1 = (color1 >> 24) & 0xFF, g1 = (color1 >> 16) & 0xFF;
-    u8 b1 = (color1 >> 8) & 0xFF, a1 = color1 & 0xFF;
-    u8 r2 = (color2 >> 24) & 0xFF, g2 = (color2 >> 16) & 0xFF;
-    u8 b2 = (color2 >> 8) & 0xFF, a2 = color2 & 0xFF;
+    const u32 native1 = PixelFormat::fromRGBA(color1);
+    const u32 native2 = PixelFormat::fromRGBA(color2);
 
+    // Row-wise filling
     for (i32 y = y0; y < y1; ++y) {
-        i32 rowChecker = (y / checkerSize) & 1;
-        // Fill in checker-sized runs for better cache utilization
-        for (i32 x = x0; x < x1; ) {
-            i32 colChecker = (x / checkerSize) & 1;
-            bool useColor1 = (rowChecker ^ colChecker) != 0;
-            u8 r = useColor1 ? r1 : r2;
-            u8 g = useColor1 ? g1 : g2;
-            u8 b = useColor1 ? b1 : b2;
-            u8 a = useColor1 ? a1 : a2;
-
-            // Calculate run length to next checker boundary
-            i32 nextBoundary = ((x / checkerSize) + 1) * checkerSize;
-            i32 runEnd = std::min(nextBoundary, x1);
-
-            // Fill the run
-            for (i32 rx = x; rx < runEnd; ++rx) {
-                size_t idx = (y * width + rx) * 4;
-                pixels[idx + 0] = r;
-                pixels[idx + 1] = g;
-                pixels[idx + 2] = b;
-                pixels[idx + 3] = a;
-            }
-            x = runEnd;
-        }
-    }
-#else
-    // Native: Optimized row-wise filling
-    for (i32 y = y0; y < y1; ++y) {
-        i32 rowChecker = (y / checkerSize) & 1;
+        i32 rowChecker = floorDiv(y - originY, checkerSize) & 1;
         u32* row = pixels.data() + y * width;
 
         // Fill in checker-sized runs for better cache utilization
         for (i32 x = x0; x < x1; ) {
-            i32 colChecker = (x / checkerSize) & 1;
-            u32 color = (rowChecker ^ colChecker) ? color1 : color2;
+            i32 colChecker = floorDiv(x - originX, checkerSize) & 1;
+            u32 color = (rowChecker ^ colChecker) ? native1 : native2;
 
             // Calculate run length to next checker boundary
-            i32 nextBoundary = ((x / checkerSize) + 1) * checkerSize;
+            i32 nextBoundary = originX + (floorDiv(x - originX, checkerSize) + 1) * checkerSize;
             i32 runEnd = std::min(nextBoundary, x1);
 
             // Fill run with std::fill for better optimization
@@ -492,7 +332,6 @@ void Framebuffer::drawCheckerboard(const Recti& rect, u32 color1, u32 color2, u3
             x = runEnd;
         }
     }
-#endif
 }
 
 void Framebuffer::blit(const Framebuffer& src, i32 dx, i32 dy) {
@@ -513,51 +352,70 @@ void Framebuffer::blit(const Framebuffer& src, i32 dx, i32 dy, const Recti& srcR
             i32 rx = dx + (sx - srcRect.x);
             if (rx < 0 || rx >= static_cast<i32>(width)) continue;
 
-#ifdef __EMSCRIPTEN__
-            size_t srcIdx = (sy * src.width + sx) * 4;
-            size_t dstIdx = (ry * width + rx) * 4;
-            pixels[dstIdx + 0] = src.pixels[srcIdx + 0];
-            pixels[dstIdx + 1] = src.pixels[srcIdx + 1];
-            pixels[dstIdx + 2] = src.pixels[srcIdx + 2];
-            pixels[dstIdx + 3] = src.pixels[srcIdx + 3];
-#else
-            u32 srcPixel = src.pixels[sy * src.width + sx];
-            pixels[ry * width + rx] = srcPixel;
-#endif
+            pixels[ry * width + rx] = src.pixels[sy * src.width + sx];
+        }
+    }
+}
+
+void Framebuffer::scroll(const Recti& rect, i32 dx, i32 dy) {
+    Recti area = rect.intersection(Recti(0, 0, static_cast<i32>(width), static_cast<i32>(height)));
+    // Destination of the pixels that stay inside the area
+    Recti dst = area.intersection(Recti(area.x + dx, area.y + dy, area.w, area.h));
+    if (dst.isEmpty()) return;
+
+    auto rowAt = [&](i32 x, i32 y) { return pixels.data() + static_cast<size_t>(y) * width + x; };
+
+    // Walk rows away from the direction of travel so no source row is
+    // overwritten before it has been moved
+    const size_t rowBytes = static_cast<size_t>(dst.w) * sizeof(u32);
+    if (dy > 0) {
+        for (i32 y = dst.y + dst.h - 1; y >= dst.y; --y) {
+            std::memmove(rowAt(dst.x, y), rowAt(dst.x - dx, y - dy), rowBytes);
+        }
+    } else {
+        for (i32 y = dst.y; y < dst.y + dst.h; ++y) {
+            std::memmove(rowAt(dst.x, y), rowAt(dst.x - dx, y - dy), rowBytes);
+        }
+    }
+}
+
+void Framebuffer::blitScaled(const Framebuffer& src, i32 dx, i32 dy, u32 factor) {
+    const i32 f = static_cast<i32>(factor);
+    Recti dst = Recti(dx, dy, static_cast<i32>(src.width) * f, static_cast<i32>(src.height) * f)
+                    .intersection(Recti(0, 0, static_cast<i32>(width), static_cast<i32>(height)));
+    if (dst.isEmpty() || f <= 0) return;
+
+    auto rowAt = [&](i32 y) { return pixels.data() + static_cast<size_t>(y) * width + dst.x; };
+
+    for (i32 y = dst.y; y < dst.y + dst.h; ++y) {
+        // Rows after the first of each block repeat it
+        if (y > dst.y && (y - dy) % f != 0) {
+            std::memcpy(rowAt(y), rowAt(y - 1), static_cast<size_t>(dst.w) * sizeof(u32));
+            continue;
+        }
+        const u32* srcRow = src.pixels.data() + static_cast<size_t>((y - dy) / f) * src.width;
+        u32* out = rowAt(y);
+        for (i32 x = dst.x; x < dst.x + dst.w; ++x) {
+            *out++ = srcRow[(x - dx) / f];
         }
     }
 }
 
 void Framebuffer::blitBlend(const Framebuffer& src, i32 dx, i32 dy) {
+    // Clip the columns once, then blend whole rows
+    i32 startX = std::max(0, -dx);
+    i32 endX = std::min(static_cast<i32>(src.width), static_cast<i32>(width) - dx);
+    if (startX >= endX) return;
+
     for (u32 sy = 0; sy < src.height; ++sy) {
         i32 ry = dy + sy;
         if (ry < 0 || ry >= static_cast<i32>(height)) continue;
 
-        for (u32 sx = 0; sx < src.width; ++sx) {
-            i32 rx = dx + sx;
-            if (rx < 0 || rx >= static_cast<i32>(width)) continue;
-
-#ifdef __EMSCRIPTEN__
-            size_t srcIdx = (sy * src.width + sx) * 4;
-            size_t dstIdx = (ry * width + rx) * 4;
-            u32 srcPixel = (static_cast<u32>(src.pixels[srcIdx + 0]) << 24) |
-                           (static_cast<u32>(src.pixels[srcIdx + 1]) << 16) |
-                           (static_cast<u32>(src.pixels[srcIdx + 2]) << 8) |
-                           static_cast<u32>(src.pixels[srcIdx + 3]);
-            u32 dstPixel = (static_cast<u32>(pixels[dstIdx + 0]) << 24) |
-                           (static_cast<u32>(pixels[dstIdx + 1]) << 16) |
-                           (static_cast<u32>(pixels[dstIdx + 2]) << 8) |
-                           static_cast<u32>(pixels[dstIdx + 3]);
-            u32 result = Blend::alphaBlend(dstPixel, srcPixel);
-            pixels[dstIdx + 0] = (result >> 24) & 0xFF;
-            pixels[dstIdx + 1] = (result >> 16) & 0xFF;
-            pixels[dstIdx + 2] = (result >> 8) & 0xFF;
-            pixels[dstIdx + 3] = result & 0xFF;
-#else
-            u32 srcPixel = src.pixels[sy * src.width + sx];
-            u32& dstPixel = pixels[ry * width + rx];
-            dstPixel = Blend::alphaBlend(dstPixel, srcPixel);
-#endif
+        u32* dst = &pixels[ry * width + dx + startX];
+        const u32* row = &src.pixels[sy * src.width + startX];
+        for (i32 x = 0; x < endX - startX; ++x) {
+            dst[x] = PixelFormat::fromRGBA(Blend::alphaBlend(PixelFormat::toRGBA(dst[x]),
+                                                             PixelFormat::toRGBA(row[x])));
         }
     }
 }
@@ -5,16 +5,14 @@
 #include "primitives.h"
 #include "blend.h"
 #include "config.h"
+#include "pixel_format.h"
 #include <vector>
 
+// Colors passed in and returned are 0xRRGGBBAA like everywhere else; pixels
+// are stored in PixelFormat's layout so present() can copy them as they are
 class Framebuffer {
 public:
-#ifdef __EMSCRIPTEN__
-    // WASM: Store in canvas RGBA byte order for zero-copy blit to JavaScript
-    std::vector<u8> pixels;
-#else
     std::vector<u32> pixels;
-#endif
     u32 width = 0;
     u32 height = 0;
 
@@ -22,11 +20,7 @@ public:
     std::vector<Recti> clipStack;
 
     Framebuffer() = default;
-#ifdef __EMSCRIPTEN__
-    Framebuffer(u32 w, u32 h) : width(w), height(h), pixels(w * h * 4, 0) {}
-#else
-    Framebuffer(u32 w, u32 h) : width(w), height(h), pixels(w * h, 0) {}
-#endif
+    Framebuffer(u32 w, u32 h) : pixels(w * h, 0), width(w), height(h) {}
 
     // Clipping support
     void pushClip(const Recti& rect);
@@ -44,6 +38,8 @@ public:
     u32 getPixel(i32 x, i32 y) const;
     void setPixel(i32 x, i32 y, u32 color);
     void blendPixel(i32 x, i32 y, u32 color);
+    // Alpha blend count colors onto row y starting at x (clipped like blendPixel)
+    void blendRow(i32 x, i32 y, const u32* colors, u32 count);
 
     // Drawing primitives
     void fillRect(const Recti& rect, u32 color);
@@ -60,26 +56,27 @@ public:
     void drawVerticalLine(i32 x, i32 y0, i32 y1, u32 color);
 
     // Patterns
+    // Squares are aligned to (originX, originY)
     void drawCheckerboard(const Recti& rect, u32 color1 = Config::CHECKER_COLOR1,
-                          u32 color2 = Config::CHECKER_COLOR2, u32 size = Config::CHECKER_SIZE);
+                          u32 color2 = Config::CHECKER_COLOR2, u32 size = Config::CHECKER_SIZE,
+                          i32 originX = 0, i32 originY = 0);
 
     // Blitting
     void blit(const Framebuffer& src, i32 dx, i32 dy);
     void blit(const Framebuffer& src, i32 dx, i32 dy, const Recti& srcRect);
     void blitBlend(const Framebuffer& src, i32 dx, i32 dy);
+    // Copy src magnified factor times (nearest neighbour) with its corner at (dx, dy)
+    void blitScaled(const Framebuffer& src, i32 dx, i32 dy, u32 factor);
 
-    // Data access
-#ifdef __EMSCRIPTEN__
-    u8* data() { return pixels.data(); }
-    const u8* data() const { return pixels.data(); }
-    size_t size() const { return width * height; }  // Pixel count
-    size_t byteSize() const { return pixels.size(); }
-#else
+    // Move the pixels inside rect by (dx, dy), dropping those that leave it.
+    // The strip uncovered at the other side keeps its old pixels.
+    void scroll(const Recti& rect, i32 dx, i32 dy);
+
+    // Data access (PixelFormat layout)
     u32* data() { return pixels.data(); }
     const u32* data() const { return pixels.data(); }
     size_t size() const { return pixels.size(); }
     size_t byteSize() const { return pixels.size() * sizeof(u32); }
-#endif
 
 private:
     void drawCircleSingle(i32 cx, i32 cy, i32 radius, u32 color);
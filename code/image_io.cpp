@@ -38,6 +38,7 @@ bool loadImage(const std::string& path, TiledCanvas& canvas) {
             }
         }
     }
+    canvas.touch();
 
     stbi_image_free(data);
     return true;
@@ -122,6 +123,7 @@ std::unique_ptr<Document> loadAsDocument(const std::string& path) {
             }
         }
     }
+    layer->canvas.touch();
 
     stbi_image_free(data);
     return doc;
@@ -131,12 +133,16 @@ bool exportPNG(const std::string& path, const Document& doc) {
     // Create output buffer (RGBA)
     std::vector<u8> pixels(doc.width * doc.height * 4, 0);
 
+    // Adjustment tables, with runs of adjustment layers fused into one
+    std::vector<const AdjustmentLut*> adjustments = fuseAdjustments(doc.layers);
+
     // Composite each pixel - same logic as compositeDocument but to a flat buffer
     for (u32 y = 0; y < doc.height; ++y) {
         for (u32 x = 0; x < doc.width; ++x) {
             u32 composited = 0;  // Start transparent
 
-            for (const auto& layer : doc.layers) {
+            for (size_t i = 0; i < doc.layers.size(); ++i) {
+                const auto& layer = doc.layers[i];
                 if (!layer->visible) continue;
 
                 u32 layerPixel = 0;
@@ -209,9 +215,9 @@ bool exportPNG(const std::string& path, const Document& doc) {
                     }
                 }
                 else if (layer->isAdjustmentLayer()) {
-                    // Apply adjustment to composited result so far
-                    const AdjustmentLayer* adj = static_cast<const AdjustmentLayer*>(layer.get());
-                    composited = Compositor::applyAdjustment(composited, *adj);
+                    // Apply adjustment (or the run of them starting here) to
+                    // composited result so far
+                    if (adjustments[i]) composited = adjustments[i]->apply(composited);
                     continue;
                 }
 
@@ -67,3 +67,44 @@ void TextLayer::ensureCacheValid() const {
 
     cacheValid = true;
 }
+
+static bool isFusable(const LayerBase& layer) {
+    return layer.isAdjustmentLayer() && layer.blend == BlendMode::Normal && layer.opacity >= 1.0f;
+}
+
+std::vector<const AdjustmentLut*> fuseAdjustments(const std::vector<std::unique_ptr<LayerBase>>& layers) {
+    std::vector<const AdjustmentLut*> luts(layers.size(), nullptr);
+    std::vector<AdjustmentStep> steps;
+
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const LayerBase& layer = *layers[i];
+        if (!layer.visible || !layer.isAdjustmentLayer()) continue;
+        const AdjustmentLayer& first = static_cast<const AdjustmentLayer&>(layer);
+
+        if (!isFusable(first)) {
+            luts[i] = &first.getLut();
+            continue;
+        }
+
+        // Extend the run over fusable adjustments, stepping past hidden layers
+        steps.assign(1, AdjustmentStep{first.type, first.params});
+        size_t end = i + 1;
+        for (size_t j = i + 1; j < layers.size(); ++j) {
+            const LayerBase& next = *layers[j];
+            if (!next.visible) continue;
+            if (!isFusable(next)) break;
+            const AdjustmentLayer& adjustment = static_cast<const AdjustmentLayer&>(next);
+            steps.push_back(AdjustmentStep{adjustment.type, adjustment.params});
+            end = j + 1;
+        }
+
+        if (steps.size() == 1) {
+            luts[i] = &first.getLut();
+        } else {
+            first.runLut.update(steps);
+            luts[i] = &first.runLut;
+        }
+        i = end - 1;
+    }
+    return luts;
+}
@@ -4,107 +4,12 @@
 #include "types.h"
 #include "primitives.h"
 #include "tiled_canvas.h"
+#include "mip_pyramid.h"
 #include "blend.h"
+#include "adjustment.h"
 #include <string>
 #include <memory>
-#include <variant>
-
-// Adjustment types
-enum class AdjustmentType {
-    BrightnessContrast,
-    TemperatureTint,
-    HueSaturation,
-    Vibrance,
-    ColorBalance,
-    HighlightsShadows,
-    Exposure,
-    Levels,
-    Invert,
-    BlackAndWhite
-};
-
-// Adjustment parameters for each type
-struct BrightnessContrastParams {
-    f32 brightness = 0.0f;  // -100 to 100
-    f32 contrast = 0.0f;    // -100 to 100
-};
-
-struct TemperatureTintParams {
-    f32 temperature = 0.0f; // -100 to 100
-    f32 tint = 0.0f;        // -100 to 100
-};
-
-struct HueSaturationParams {
-    f32 hue = 0.0f;         // -180 to 180
-    f32 saturation = 0.0f;  // -100 to 100
-    f32 lightness = 0.0f;   // -100 to 100
-};
-
-struct VibranceParams {
-    f32 vibrance = 0.0f;    // -100 to 100
-};
-
-struct ColorBalanceParams {
-    f32 shadowsCyanRed = 0.0f;
-    f32 shadowsMagentaGreen = 0.0f;
-    f32 shadowsYellowBlue = 0.0f;
-    f32 midtonesCyanRed = 0.0f;
-    f32 midtonesMagentaGreen = 0.0f;
-    f32 midtonesYellowBlue = 0.0f;
-    f32 highlightsCyanRed = 0.0f;
-    f32 highlightsMagentaGreen = 0.0f;
-    f32 highlightsYellowBlue = 0.0f;
-};
-
-struct HighlightsShadowsParams {
-    f32 highlights = 0.0f;  // -100 to 100
-    f32 shadows = 0.0f;     // -100 to 100
-};
-
-struct ExposureParams {
-    f32 exposure = 0.0f;    // -5 to 5
-    f32 offset = 0.0f;      // -0.1 to 0.1
-    f32 gamma = 1.0f;       // 0.01 to 9.99
-};
-
-struct LevelsParams {
-    // Input levels: black point, gamma, white point (0-255)
-    f32 inputBlack = 0.0f;
-    f32 inputGamma = 1.0f;
-    f32 inputWhite = 255.0f;
-    // Output levels
-    f32 outputBlack = 0.0f;
-    f32 outputWhite = 255.0f;
-};
-
-struct InvertParams {
-    // No parameters needed
-};
-
-struct BlackAndWhiteParams {
-    f32 reds = 40.0f;
-    f32 yellows = 60.0f;
-    f32 greens = 40.0f;
-    f32 cyans = 60.0f;
-    f32 blues = 20.0f;
-    f32 magentas = 80.0f;
-    f32 tintHue = 0.0f;
-    f32 tintAmount = 0.0f;
-};
-
-// Variant type for all adjustment params
-using AdjustmentParams = std::variant<
-    BrightnessContrastParams,
-    TemperatureTintParams,
-    HueSaturationParams,
-    VibranceParams,
-    ColorBalanceParams,
-    HighlightsShadowsParams,
-    ExposureParams,
-    LevelsParams,
-    InvertParams,
-    BlackAndWhiteParams
->;
+#include <vector>
 
 // Base layer class
 struct LayerBase {
@@ -130,6 +35,9 @@ struct LayerBase {
 struct PixelLayer : LayerBase {
     TiledCanvas canvas;
 
+    // Downsampled levels for zoomed-out views, built on demand by the renderer
+    mutable MipPyramid mips;
+
     PixelLayer() = default;
     PixelLayer(u32 w, u32 h) : canvas(w, h) {}
 
@@ -144,11 +52,7 @@ struct PixelLayer : LayerBase {
         copy->visible = visible;
         copy->blend = blend;
         // Deep copy canvas
-        copy->canvas.width = canvas.width;
-        copy->canvas.height = canvas.height;
-        for (const auto& [key, tile] : canvas.tiles) {
-            copy->canvas.tiles[key] = tile->clone();
-        }
+        copy->canvas = std::move(*canvas.clone());
         return copy;
     }
 };
@@ -165,6 +69,7 @@ struct TextLayer : LayerBase {
     // Cached rasterized version
     mutable TiledCanvas rasterizedCache;
     mutable bool cacheValid = false;
+    mutable MipPyramid mips;
 
     bool isTextLayer() const override { return true; }
 
@@ -197,6 +102,11 @@ struct AdjustmentLayer : LayerBase {
     AdjustmentType type = AdjustmentType::BrightnessContrast;
     AdjustmentParams params;
 
+    // type and params compiled into lookup tables, see getLut()
+    mutable AdjustmentLut lut;
+    // Tables for a run of adjustments starting at this layer, see fuseAdjustments()
+    mutable AdjustmentLut runLut;
+
     AdjustmentLayer() {
         params = BrightnessContrastParams();
     }
@@ -207,6 +117,13 @@ struct AdjustmentLayer : LayerBase {
 
     bool isAdjustmentLayer() const override { return true; }
 
+    // Lookup tables for the current type and params, rebuilt when they have
+    // changed. Call from one thread before sharing the tables with others.
+    const AdjustmentLut& getLut() const {
+        lut.update(type, params);
+        return lut;
+    }
+
     void setDefaultParams(AdjustmentType t) {
         type = t;
         switch (t) {
@@ -257,4 +174,12 @@ const T* getAdjustmentParams(const AdjustmentLayer* layer) {
     return std::get_if<T>(&layer->params);
 }
 
+// Adjustment tables for walking a layer stack bottom to top. Adjacent visible
+// adjustment layers with Normal blending and full opacity (hidden layers in
+// between don't count) are applied as one: the first layer of the run gets
+// tables for the whole run and the rest get nullptr. Any other visible
+// adjustment layer gets its own tables; all other entries are nullptr.
+// Call from one thread before sharing the tables.
+std::vector<const AdjustmentLut*> fuseAdjustments(const std::vector<std::unique_ptr<LayerBase>>& layers);
+
 #endif
@@ -83,7 +83,10 @@ int main(int argc, char* argv[]) {
 #include "material_font.cpp"
 #include "inter_font.cpp"
 #include "primitives.cpp"
+#include "rect_region.cpp"
 #include "tile.cpp"
+#include "tile_pool.cpp"
+#include "tile_index.cpp"
 #include "tiled_canvas.cpp"
 #include "layer.cpp"
 #include "undo.cpp"
@@ -107,8 +110,13 @@ int main(int argc, char* argv[]) {
 #include "main_window.cpp"
 #include "framebuffer.cpp"
 #include "sampler.cpp"
+#include "mip_pyramid.cpp"
+#include "adjustment.cpp"
 #include "blend.cpp"
 #include "compositor.cpp"
+#include "composite_cache.cpp"
+#include "thread_pool.cpp"
+#include "canvas_renderer.cpp"
 #include "brush_renderer.cpp"
 #include "image_io.cpp"
 #include "project_file.cpp"
@@ -25,6 +25,7 @@ void DocumentViewWidget::setDocument(Document* doc) {
         view.document->removeObserver(this);
     }
     view.setDocument(doc);
+    canvasRenderer.reset();
     if (doc) {
         doc->addObserver(this);
         needsCentering = true;
@@ -63,12 +64,13 @@ void DocumentViewWidget::renderSelf(Framebuffer& fb) {
         getAppState().needsRedraw = true;
     }
 
-    // Note: Background fill removed - application.cpp already clears framebuffer
-    // Checkerboard will be drawn by compositor for document area
-
     if (view.document) {
-        Compositor::compositeDocument(fb, *view.document, view.viewport,
-                                      view.zoom, view.pan);
+        renderCanvas(fb, Recti(global));
+
+        if (view.document->selection.hasSelection) {
+            Compositor::drawMarchingAnts(fb, view.document->selection, view.viewport,
+                                         view.zoom, view.pan, Platform::getMilliseconds());
+        }
 
         Tool* tool = view.document->getTool();
         bool showOverlay = tool && tool->hasOverlay() &&
@@ -94,6 +96,79 @@ void DocumentViewWidget::renderSelf(Framebuffer& fb) {
     }
 }
 
+void DocumentViewWidget::renderCanvas(Framebuffer& fb, const Recti& area) {
+    if (area.isEmpty()) return;
+    const Document& doc = *view.document;
+    AppState& state = getAppState();
+
+    CanvasState current;
+    current.document = &doc;
+    current.zoom = view.zoom;
+    current.pan = view.pan;
+    current.area = area;
+    current.pixelGrid = state.showPixelGrid;
+    current.signature = CompositeCache::computeSignature(doc);
+    current.contentSignature = CompositeCache::computeContentSignature(doc);
+
+    // Floating content and text waiting to be rasterized change the picture
+    // without going through the signatures
+    bool changed = !(current == requested) || !canvasDirty.isEmpty() || layersChanged ||
+                   doc.floatingContent.active;
+    for (const auto& layer : doc.layers) {
+        if (layer->visible && layer->isTextLayer() &&
+            !static_cast<const TextLayer*>(layer.get())->cacheValid) {
+            changed = true;
+        }
+    }
+
+    const bool interacting = state.mouseDown ||
+                             Platform::getMilliseconds() < state.lastInputTime + Config::VIEW_PREVIEW_IDLE_MS;
+    const Framebuffer* frame = canvasRenderer.acquire();
+    bool refine = !interacting && canvasRenderer.needsRefinement();
+
+    if (changed || refine) {
+        if (canvasRenderer.isBusy()) {
+            // Only the newest state matters; have the renderer wrap up
+            canvasRenderer.interrupt();
+        } else {
+            CanvasRenderer::Request request;
+            request.zoom = current.zoom;
+            request.pan = current.pan;
+            request.width = area.w;
+            request.height = area.h;
+            request.pixelGrid = current.pixelGrid;
+            request.interacting = interacting;
+            request.dirty = canvasDirty;
+            request.layersChanged = layersChanged;
+            canvasRenderer.submit(doc, request);
+
+            // Submitting may have rasterized text
+            current.contentSignature = CompositeCache::computeContentSignature(doc);
+            requested = current;
+            canvasDirty = Rect();
+            layersChanged = false;
+            changed = false;
+            frame = canvasRenderer.acquire();
+        }
+    }
+
+    // Come back next frame for the renderer's result or to send what changed
+    if (changed || canvasRenderer.isBusy() || canvasRenderer.needsRefinement()) {
+        state.pendingRefine = area;
+    }
+
+    // Copy the part of the frame inside the framebuffer's clip. Until the
+    // renderer catches up the frame may be from an older state or size.
+    if (!frame) return;
+    Recti visible = area.intersection(Recti(area.x, area.y, static_cast<i32>(frame->width),
+                                            static_cast<i32>(frame->height)));
+    if (fb.hasClip()) visible = visible.intersection(fb.currentClip());
+    if (!visible.isEmpty()) {
+        fb.blit(*frame, visible.x, visible.y,
+                Recti(visible.x - area.x, visible.y - area.y, visible.w, visible.h));
+    }
+}
+
 void DocumentViewWidget::drawEllipseOutline(Framebuffer& fb, i32 cx, i32 cy, i32 rx, i32 ry, u32 color) {
     if (rx <= 0 || ry <= 0) return;
 
@@ -456,7 +531,25 @@ void DocumentViewWidget::onMouseLeave(const MouseEvent& e) {
     getAppState().needsRedraw = true;
 }
 
+void DocumentViewWidget::onLayerAdded(i32) {
+    layersChanged = true;
+}
+
+void DocumentViewWidget::onLayerRemoved(i32) {
+    layersChanged = true;
+}
+
+void DocumentViewWidget::onLayerMoved(i32, i32) {
+    layersChanged = true;
+}
+
+void DocumentViewWidget::onLayerChanged(i32) {
+    layersChanged = true;
+}
+
 void DocumentViewWidget::onDocumentChanged(const Rect& dirtyRect) {
+    canvasDirty = canvasDirty.united(dirtyRect);
+
     // If we have a specific dirty rect, convert to screen coordinates and mark dirty
     if (dirtyRect.w > 0 && dirtyRect.h > 0) {
         // Convert document rect to screen coordinates
@@ -1769,6 +1862,15 @@ PopupMenu* MenuBar::createViewMenu() {
 
     menu->addSeparator();
 
+    menu->addItem("Pixel Grid", "", [this]() {
+        closeActiveMenu();
+        AppState& state = getAppState();
+        state.showPixelGrid = !state.showPixelGrid;
+        state.needsRedraw = true;
+    });
+
+    menu->addSeparator();
+
     menu->addItem("Fit Screen", "", [this]() {
         closeActiveMenu();
         if (onFitToScreen) onFitToScreen();
@@ -2607,6 +2709,14 @@ MainWindow::MainWindow() {
     getAppState().onActiveDocumentChanged = [this]() {
         connectToDocument();
     };
+
+    // Detach the view before a document it shows is destroyed, which also
+    // drops the renderer's snapshot so the document's tiles can be trimmed
+    getAppState().onDocumentClosing = [this](Document* doc) {
+        if (docView && docView->view.document == doc) {
+            docView->setDocument(nullptr);
+        }
+    };
 }
 
 void MainWindow::createDialogs() {
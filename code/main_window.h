@@ -8,6 +8,7 @@
 #include "document.h"
 #include "document_view.h"
 #include "compositor.h"
+#include "canvas_renderer.h"
 #include "app_state.h"
 #include "tool.h"
 #include "brush_tool.h"
@@ -60,6 +61,41 @@ public:
 
     // DocumentObserver
     void onDocumentChanged(const Rect& dirtyRect) override;
+    void onLayerAdded(i32 index) override;
+    void onLayerRemoved(i32 index) override;
+    void onLayerMoved(i32 fromIndex, i32 toIndex) override;
+    void onLayerChanged(i32 index) override;
+
+private:
+    // The composited document (background, checkerboard, layers, pixel grid)
+    // is drawn by canvasRenderer on its own thread (see canvas_renderer.h).
+    // Each frame the widget sends a request if anything changed since the
+    // last one, or if the last frame is a preview and input has been idle for
+    // Config::VIEW_PREVIEW_IDLE_MS, then copies the newest finished frame.
+    // While the renderer has work left, AppState::pendingRefine keeps frames
+    // coming. Overlays and marching ants are drawn over the copy.
+    struct CanvasState {
+        const Document* document = nullptr;
+        f32 zoom = 0.0f;
+        Vec2 pan;
+        Recti area;
+        bool pixelGrid = false;
+        u64 signature = 0;
+        u64 contentSignature = 0;
+
+        bool operator==(const CanvasState& other) const {
+            return document == other.document && zoom == other.zoom && pan == other.pan &&
+                   area == other.area && pixelGrid == other.pixelGrid &&
+                   signature == other.signature && contentSignature == other.contentSignature;
+        }
+    };
+    CanvasRenderer canvasRenderer;
+    CanvasState requested;      // State sent with the last request
+    Rect canvasDirty;           // Document area edited since the last request
+    bool layersChanged = false; // Layer list changed since the last request
+
+    // Send the renderer what changed and copy its newest frame to fb
+    void renderCanvas(Framebuffer& fb, const Recti& area);
 };
 
 // Tool palette
@@ -0,0 +1,134 @@
+#include "mip_pyramid.h"
+
+// Alpha-weighted average of a 2x2 block, so transparent pixels don't darken edges
+static inline u32 averageQuad(u32 p0, u32 p1, u32 p2, u32 p3) {
+    u32 a0 = p0 & 0xFF, a1 = p1 & 0xFF, a2 = p2 & 0xFF, a3 = p3 & 0xFF;
+    u32 alphaSum = a0 + a1 + a2 + a3;
+    if (alphaSum == 0) return 0;
+
+    // Equal weights (the common, opaque case): a plain average, two channels
+    // at a time in 16-bit halves
+    if (a0 == a1 && a0 == a2 && a0 == a3) {
+        const u32 mask = 0x00FF00FF;
+        u32 rb = ((p0 >> 8) & mask) + ((p1 >> 8) & mask) + ((p2 >> 8) & mask) + ((p3 >> 8) & mask);
+        u32 ga = (p0 & mask) + (p1 & mask) + (p2 & mask) + (p3 & mask);
+        return ((((rb + 0x00020002) >> 2) & mask) << 8) | (((ga + 0x00020002) >> 2) & mask);
+    }
+
+    auto channel = [&](u32 shift) -> u32 {
+        u32 sum = ((p0 >> shift) & 0xFF) * a0 + ((p1 >> shift) & 0xFF) * a1 +
+                  ((p2 >> shift) & 0xFF) * a2 + ((p3 >> shift) & 0xFF) * a3;
+        return (sum + alphaSum / 2) / alphaSum;
+    };
+
+    return (channel(24) << 24) | (channel(16) << 16) | (channel(8) << 8) | ((alphaSum + 2) / 4);
+}
+
+// Box filter four tiles (top-left, top-right, bottom-left, bottom-right) into one
+static TileRef downsampleTiles(const TileRef (&children)[4]) {
+    if (!children[0] && !children[1] && !children[2] && !children[3]) return nullptr;
+
+    // Four copies of the same solid tile average to that tile
+    if (children[0] && children[0]->solid && children[0].get() == children[1].get() &&
+        children[0].get() == children[2].get() && children[0].get() == children[3].get()) {
+        return TiledCanvas::solidTile(children[0]->solidColor);
+    }
+
+    const u32 size = Config::TILE_SIZE;
+    const u32 half = size / 2;
+    auto tile = std::make_unique<Tile>();
+
+    for (u32 quad = 0; quad < 4; ++quad) {
+        const Tile* child = children[quad].get();
+        if (!child) continue;
+
+        u32 offsetX = (quad & 1) * half;
+        u32 offsetY = (quad >> 1) * half;
+
+        if (child->solid) {
+            for (u32 y = 0; y < half; ++y) {
+                u32* dst = tile->pixels + (offsetY + y) * size + offsetX;
+                for (u32 x = 0; x < half; ++x) dst[x] = child->solidColor;
+            }
+            continue;
+        }
+
+        for (u32 y = 0; y < half; ++y) {
+            const u32* row0 = child->pixels + (y * 2) * size;
+            const u32* row1 = row0 + size;
+            u32* dst = tile->pixels + (offsetY + y) * size + offsetX;
+            for (u32 x = 0; x < half; ++x) {
+                dst[x] = averageQuad(row0[x * 2], row0[x * 2 + 1], row1[x * 2], row1[x * 2 + 1]);
+            }
+        }
+    }
+
+    if (tile->isEmpty()) return nullptr;
+    return TileRef(std::move(tile));
+}
+
+void MipPyramid::clear() {
+    levels.clear();
+    sourceWidth = 0;
+    sourceHeight = 0;
+    sourceRevision = 0;
+}
+
+void MipPyramid::prepare(const TiledCanvas& source, u32 maxLevel, const Recti& bounds) {
+    if (source.width != sourceWidth || source.height != sourceHeight) {
+        clear();
+        sourceWidth = source.width;
+        sourceHeight = source.height;
+    }
+
+    while (levels.size() < maxLevel) {
+        u32 k = static_cast<u32>(levels.size()) + 1;
+        u32 scale = 1u << k;
+        levels.push_back(Level{TiledCanvas((sourceWidth + scale - 1) / scale,
+                                           (sourceHeight + scale - 1) / scale), {}});
+    }
+    if (maxLevel == 0 || bounds.w <= 0 || bounds.h <= 0) return;
+
+    if (source.revision != sourceRevision) {
+        sourceRevision = source.revision;
+        ++epoch;
+    }
+
+    // Level tiles of the top level covering bounds; updating them walks
+    // every level below over the same area
+    i32 span = static_cast<i32>(Config::TILE_SIZE) << maxLevel;
+    i32 startX = floorDiv(bounds.x, span);
+    i32 startY = floorDiv(bounds.y, span);
+    i32 endX = floorDiv(bounds.x + bounds.w - 1, span);
+    i32 endY = floorDiv(bounds.y + bounds.h - 1, span);
+
+    for (i32 ty = startY; ty <= endY; ++ty) {
+        for (i32 tx = startX; tx <= endX; ++tx) {
+            update(source, maxLevel, tx, ty);
+        }
+    }
+}
+
+TileRef MipPyramid::update(const TiledCanvas& source, u32 level, i32 tileX, i32 tileY) {
+    if (level == 0) return source.shareTile(tileX, tileY);
+
+    // The recursion below only touches lower levels, so entry stays valid
+    Level& target = levels[level - 1];
+    Entry& entry = target.entries[makeTileKey(tileX, tileY)];
+    if (entry.checked == epoch) return target.canvas.shareTile(tileX, tileY);
+
+    TileRef children[4];
+    bool changed = false;
+    for (u32 i = 0; i < 4; ++i) {
+        children[i] = update(source, level - 1, tileX * 2 + static_cast<i32>(i & 1),
+                             tileY * 2 + static_cast<i32>(i >> 1));
+        if (children[i].get() != entry.sources[i].get()) changed = true;
+    }
+
+    if (changed) {
+        target.canvas.setTile(tileX, tileY, downsampleTiles(children));
+        for (u32 i = 0; i < 4; ++i) entry.sources[i] = std::move(children[i]);
+    }
+    entry.checked = epoch;
+    return target.canvas.shareTile(tileX, tileY);
+}
@@ -0,0 +1,133 @@
+#ifndef _H_MIP_PYRAMID_
+#define _H_MIP_PYRAMID_
+
+#include "types.h"
+#include "primitives.h"
+#include "tiled_canvas.h"
+#include "sampler.h"
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+
+// Downsampled copies of a canvas for zoomed-out viewing. Level k is the source
+// box-filtered by 2^k and tiled on the same grid, so each level tile is built
+// from the 2x2 tiles under it in the level below.
+// Levels are built lazily, only over the area somebody asks for. Every level
+// tile holds handles to the tiles it was made from; tiles are copy-on-write,
+// so any edit to the source swaps those tiles out and a handle comparison
+// finds exactly the level tiles that are stale.
+class MipPyramid {
+public:
+    MipPyramid() = default;
+    MipPyramid(MipPyramid&&) = default;
+    MipPyramid& operator=(MipPyramid&&) = default;
+
+    // Bring levels 1..maxLevel up to date over a rect of source pixels.
+    // Call from one thread before reading levels; sample() only reads.
+    void prepare(const TiledCanvas& source, u32 maxLevel, const Recti& bounds);
+
+    // Trilinear sample at source coordinates. lod is log2 of source pixels
+    // per output pixel; lod <= 0 is a plain bilinear sample of the source.
+    u32 sample(const TiledCanvas& source, f32 x, f32 y, f32 lod) const {
+        if (lod <= 0.0f) return sampleLevel(source, 0, x, y);
+
+        u32 top = static_cast<u32>(levels.size());
+        if (lod >= static_cast<f32>(top)) return sampleLevel(source, top, x, y);
+
+        u32 level = static_cast<u32>(lod);
+        u32 weight = static_cast<u32>((lod - static_cast<f32>(level)) * 256.0f);
+        u32 a = sampleLevel(source, level, x, y);
+        if (weight == 0) return a;
+        return lerpPixel(a, sampleLevel(source, level + 1, x, y), weight);
+    }
+
+    // Canvas of one level (level 0 is the source). Only areas passed to
+    // prepare() are filled in.
+    const TiledCanvas& getLevel(const TiledCanvas& source, u32 level) const {
+        return level == 0 ? source : levels[level - 1].canvas;
+    }
+
+    // Level needed to sample at lod without clamping to a coarser one
+    static u32 levelFor(f32 lod) {
+        return lod > 0.0f ? static_cast<u32>(std::ceil(lod)) : 0;
+    }
+
+    // Drop every level (and the source tiles they hold on to)
+    void clear();
+
+    u32 getLevelCount() const { return static_cast<u32>(levels.size()); }
+
+private:
+    // Blend two pixels channel-wise, weight 0..256 towards b. Red/blue and
+    // green/alpha are done in pairs, one channel per 16-bit half.
+    static u32 lerpPixel(u32 a, u32 b, u32 weight) {
+        u32 inverse = 256 - weight;
+        u32 rb = ((a & 0x00FF00FF) * inverse + (b & 0x00FF00FF) * weight + 0x00800080) >> 8;
+        u32 ga = (((a >> 8) & 0x00FF00FF) * inverse + ((b >> 8) & 0x00FF00FF) * weight + 0x00800080) >> 8;
+        return (rb & 0x00FF00FF) | ((ga & 0x00FF00FF) << 8);
+    }
+
+    // Bilinear sample of one level; level pixel j covers source pixels
+    // [j * 2^k, (j + 1) * 2^k), so coordinates are scaled about pixel centres
+    u32 sampleLevel(const TiledCanvas& source, u32 level, f32 x, f32 y) const {
+        const TiledCanvas& canvas = getLevel(source, level);
+        if (level > 0) {
+            f32 scale = 1.0f / static_cast<f32>(1u << level);
+            x = (x + 0.5f) * scale - 0.5f;
+            y = (y + 0.5f) * scale - 0.5f;
+        }
+
+        // Truncate and step down for negatives; std::floor is a libm call
+        // without SSE4.1
+        i32 x0 = static_cast<i32>(x);
+        i32 y0 = static_cast<i32>(y);
+        if (static_cast<f32>(x0) > x) --x0;
+        if (static_cast<f32>(y0) > y) --y0;
+        u32 weightX = static_cast<u32>((x - static_cast<f32>(x0)) * 256.0f);
+        u32 weightY = static_cast<u32>((y - static_cast<f32>(y0)) * 256.0f);
+
+        u32 c00, c10, c01, c11;
+        u32 localX = floorMod(x0, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(y0, static_cast<i32>(Config::TILE_SIZE));
+        if (localX + 1 < Config::TILE_SIZE && localY + 1 < Config::TILE_SIZE) {
+            const Tile* tile = canvas.getTile(floorDiv(x0, static_cast<i32>(Config::TILE_SIZE)),
+                                              floorDiv(y0, static_cast<i32>(Config::TILE_SIZE)));
+            if (!tile) return 0;
+            if (tile->solid) return tile->solidColor;
+            const u32* row = tile->pixels + localY * Config::TILE_SIZE + localX;
+            c00 = row[0];
+            c10 = row[1];
+            c01 = row[Config::TILE_SIZE];
+            c11 = row[Config::TILE_SIZE + 1];
+        } else {
+            c00 = canvas.getPixel(x0, y0);
+            c10 = canvas.getPixel(x0 + 1, y0);
+            c01 = canvas.getPixel(x0, y0 + 1);
+            c11 = canvas.getPixel(x0 + 1, y0 + 1);
+        }
+
+        return lerpPixel(lerpPixel(c00, c10, weightX), lerpPixel(c01, c11, weightX), weightY);
+    }
+
+    // Return level tile (tileX, tileY), rebuilding it (and whatever it depends
+    // on) if the source changed underneath it
+    TileRef update(const TiledCanvas& source, u32 level, i32 tileX, i32 tileY);
+
+    struct Entry {
+        TileRef sources[4];   // The 2x2 tiles of the level below it was built from
+        u64 checked = 0;      // Epoch it was last compared against them
+    };
+
+    struct Level {
+        TiledCanvas canvas;
+        std::unordered_map<u64, Entry> entries;
+    };
+
+    std::vector<Level> levels;   // levels[k - 1] holds level k
+    u32 sourceWidth = 0;
+    u32 sourceHeight = 0;
+    u64 sourceRevision = 0;
+    u64 epoch = 1;               // Bumped whenever the source revision moves
+};
+
+#endif
@@ -79,15 +79,43 @@ void NavigatorThumbnail::renderSelf(Framebuffer& fb) {
         }
     }
 
+    // Shrunk documents are read from the layers' mip levels, so each thumbnail
+    // pixel averages the whole area it covers
+    f32 lod = thumbScale < 1.0f ? std::log2(1.0f / thumbScale) : 0.0f;
+    if (lod > 0.0f) {
+        u32 level = MipPyramid::levelFor(lod);
+        for (const auto& layer : doc->layers) {
+            if (!layer->visible) continue;
+            if (layer->isPixelLayer()) {
+                const PixelLayer* pixelLayer = static_cast<const PixelLayer*>(layer.get());
+                const TiledCanvas& canvas = pixelLayer->canvas;
+                pixelLayer->mips.prepare(canvas, level, Recti(0, 0, canvas.width, canvas.height));
+            } else if (layer->isTextLayer()) {
+                const TextLayer* textLayer = static_cast<const TextLayer*>(layer.get());
+                textLayer->ensureCacheValid();
+                const TiledCanvas& canvas = textLayer->rasterizedCache;
+                textLayer->mips.prepare(canvas, level, Recti(0, 0, canvas.width, canvas.height));
+            }
+        }
+    }
+
+    // Adjustment tables, with runs of adjustment layers fused into one
+    adjustments = fuseAdjustments(doc->layers);
+
     // Sample document pixels at thumbnail resolution
     for (i32 ty = 0; ty < thumbH; ++ty) {
         for (i32 tx = 0; tx < thumbW; ++tx) {
-            // Convert thumbnail position to document coordinates
+            // Convert thumbnail position to document coordinates (the centre
+            // of its footprint when filtering)
             f32 docX = static_cast<f32>(tx) / thumbScale;
             f32 docY = static_cast<f32>(ty) / thumbScale;
+            if (lod > 0.0f) {
+                docX = (static_cast<f32>(tx) + 0.5f) / thumbScale - 0.5f;
+                docY = (static_cast<f32>(ty) + 0.5f) / thumbScale - 0.5f;
+            }
 
             // Sample all visible layers (simplified compositing)
-            u32 pixel = sampleDocumentAt(doc, docX, docY);
+            u32 pixel = sampleDocumentAt(doc, docX, docY, lod);
 
             if ((pixel & 0xFF) > 0) {  // Has alpha
                 // Blend onto checkerboard
@@ -138,11 +166,12 @@ bool NavigatorThumbnail::onMouseUp(const MouseEvent& e) {
     return false;
 }
 
-u32 NavigatorThumbnail::sampleDocumentAt(Document* doc, f32 docX, f32 docY) {
+u32 NavigatorThumbnail::sampleDocumentAt(Document* doc, f32 docX, f32 docY, f32 lod) {
     u32 result = 0;  // Start transparent
 
     // Composite visible layers from bottom to top
-    for (const auto& layer : doc->layers) {
+    for (size_t i = 0; i < doc->layers.size(); ++i) {
+        const auto& layer = doc->layers[i];
         if (!layer->visible) continue;
 
         u32 layerPixel = 0;
@@ -157,9 +186,13 @@ u32 NavigatorThumbnail::sampleDocumentAt(Document* doc, f32 docX, f32 docY) {
             // Check bounds
             if (layerX >= 0 && layerX < pixelLayer->canvas.width &&
                 layerY >= 0 && layerY < pixelLayer->canvas.height) {
-                i32 ix = static_cast<i32>(layerX);
-                i32 iy = static_cast<i32>(layerY);
-                layerPixel = pixelLayer->canvas.getPixel(ix, iy);
+                if (lod > 0.0f) {
+                    layerPixel = pixelLayer->mips.sample(pixelLayer->canvas, layerX, layerY, lod);
+                } else {
+                    i32 ix = static_cast<i32>(layerX);
+                    i32 iy = static_cast<i32>(layerY);
+                    layerPixel = pixelLayer->canvas.getPixel(ix, iy);
+                }
             }
         }
         else if (layer->isTextLayer()) {
@@ -173,16 +206,20 @@ u32 NavigatorThumbnail::sampleDocumentAt(Document* doc, f32 docX, f32 docY) {
             // Check bounds against rasterized cache
             if (layerX >= 0 && layerX < textLayer->rasterizedCache.width &&
                 layerY >= 0 && layerY < textLayer->rasterizedCache.height) {
-                i32 ix = static_cast<i32>(layerX);
-                i32 iy = static_cast<i32>(layerY);
-                layerPixel = textLayer->rasterizedCache.getPixel(ix, iy);
+                if (lod > 0.0f) {
+                    layerPixel = textLayer->mips.sample(textLayer->rasterizedCache, layerX, layerY, lod);
+                } else {
+                    i32 ix = static_cast<i32>(layerX);
+                    i32 iy = static_cast<i32>(layerY);
+                    layerPixel = textLayer->rasterizedCache.getPixel(ix, iy);
+                }
             }
         }
         else if (layer->isAdjustmentLayer()) {
-            // Apply adjustment to composited result so far
-            const AdjustmentLayer* adj = static_cast<const AdjustmentLayer*>(layer.get());
-            if ((result & 0xFF) > 0) {
-                result = Compositor::applyAdjustment(result, *adj);
+            // Apply adjustment (or the run of them starting here) to
+            // composited result so far
+            if (i < adjustments.size() && adjustments[i]) {
+                result = adjustments[i]->apply(result);
             }
             continue;  // Don't blend - adjustment modifies existing pixels
         }
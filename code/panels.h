@@ -39,7 +39,10 @@ public:
     bool onMouseUp(const MouseEvent& e) override;
 
 private:
-    u32 sampleDocumentAt(Document* doc, f32 docX, f32 docY);
+    std::vector<const AdjustmentLut*> adjustments;   // From fuseAdjustments, per render
+
+    // lod > 0 reads the layers' mip levels (see MipPyramid::sample)
+    u32 sampleDocumentAt(Document* doc, f32 docX, f32 docY, f32 lod = 0.0f);
     void drawViewportRect(Framebuffer& fb);
     void panToThumbnailPos(Vec2 localPos);
 };
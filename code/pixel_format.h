@@ -0,0 +1,24 @@
+#ifndef _H_PIXEL_FORMAT_
+#define _H_PIXEL_FORMAT_
+
+#include "types.h"
+
+// Memory layout of Framebuffer pixels, fixed at compile time to what the
+// platform presents, so a finished frame goes to the screen as a plain copy.
+// Everything else (tiles, Blend, colors passed to Framebuffer) uses 0xRRGGBBAA.
+// Alpha is in the top byte of both layouts.
+struct PixelFormat {
+#ifdef __EMSCRIPTEN__
+    // Canvas ImageData bytes R, G, B, A: 0xAABBGGRR as a little-endian u32
+    static constexpr u32 fromRGBA(u32 c) {
+        return (c >> 24) | ((c >> 8) & 0xFF00) | ((c << 8) & 0xFF0000) | (c << 24);
+    }
+    static constexpr u32 toRGBA(u32 p) { return fromRGBA(p); }
+#else
+    // 32-bit X11 visuals and Windows DIB sections: 0xAARRGGBB
+    static constexpr u32 fromRGBA(u32 c) { return (c >> 8) | (c << 24); }
+    static constexpr u32 toRGBA(u32 p) { return (p << 8) | (p >> 24); }
+#endif
+};
+
+#endif
@@ -40,8 +40,12 @@ struct PlatformWindow {
 
     // Rendering
     virtual void present(const u32* pixels, u32 w, u32 h) = 0;
-    virtual void presentPartial(const u32* pixels, u32 w, u32 h, i32 dx, i32 dy, i32 dw, i32 dh) {
+    // Present only the given rects of the frame; the rest of the window keeps
+    // what was last presented
+    virtual void presentPartial(const u32* pixels, u32 w, u32 h, const Recti* rects, u32 count) {
         // Default: full present (platforms can override for optimization)
+        (void)rects;
+        (void)count;
         present(pixels, w, h);
     }
 
@@ -49,6 +53,10 @@ struct PlatformWindow {
     // Returns false if window should close
     virtual bool processEvents() = 0;
 
+    // Block until events are pending or timeoutMs passes (-1 waits until an
+    // event arrives). Platforms that drive frames themselves (WASM) never wait.
+    virtual void waitForEvents(i32 timeoutMs) { (void)timeoutMs; }
+
     // Event callbacks (set by Application)
     std::function<void()> onCloseRequested;
     std::function<void(i32 keyCode, i32 scanCode, KeyMods mods, bool repeat)> onKeyDown;
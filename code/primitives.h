@@ -163,6 +163,28 @@ struct Recti {
     bool contains(i32 px, i32 py) const {
         return px >= x && px < x + w && py >= y && py < y + h;
     }
+
+    bool intersects(const Recti& other) const {
+        return !(other.x >= x + w || other.x + other.w <= x ||
+                 other.y >= y + h || other.y + other.h <= y);
+    }
+
+    Recti intersection(const Recti& other) const {
+        i32 nx = std::max(x, other.x);
+        i32 ny = std::max(y, other.y);
+        i32 nw = std::min(x + w, other.x + other.w) - nx;
+        i32 nh = std::min(y + h, other.y + other.h) - ny;
+        if (nw <= 0 || nh <= 0) return Recti();
+        return Recti(nx, ny, nw, nh);
+    }
+
+    bool isEmpty() const { return w <= 0 || h <= 0; }
+
+    bool operator==(const Recti& other) const {
+        return x == other.x && y == other.y && w == other.w && h == other.h;
+    }
+
+    bool operator!=(const Recti& other) const { return !(*this == other); }
 };
 
 struct Color {
@@ -350,6 +372,17 @@ inline i32 clamp(i32 value, i32 min, i32 max) {
     return std::max(min, std::min(max, value));
 }
 
+// Floor division that works correctly for negative numbers
+inline i32 floorDiv(i32 a, i32 b) {
+    return (a >= 0) ? (a / b) : ((a - b + 1) / b);
+}
+
+// Positive modulo that works correctly for negative numbers
+inline u32 floorMod(i32 a, i32 b) {
+    i32 m = a % b;
+    return static_cast<u32>(m < 0 ? m + b : m);
+}
+
 inline f32 lerp(f32 a, f32 b, f32 t) {
     return a + (b - a) * t;
 }
@@ -119,15 +119,13 @@ bool save(const std::string& path, const Document& doc) {
             const PixelLayer* pixel = static_cast<const PixelLayer*>(layer.get());
             const TiledCanvas& canvas = pixel->canvas;
 
-            writer.write(static_cast<u32>(canvas.tiles.size()));
+            writer.write(static_cast<u32>(canvas.getTileCount()));
 
-            for (const auto& [key, tile] : canvas.tiles) {
-                i32 tileX, tileY;
-                extractTileCoords(key, tileX, tileY);
+            canvas.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
                 writer.write(tileX);
                 writer.write(tileY);
-                writer.writeBytes(tile->pixels, sizeof(tile->pixels));
-            }
+                writer.writeBytes(tile.pixels, sizeof(tile.pixels));
+            });
         }
         else if (layer->isTextLayer()) {
             const TextLayer* text = static_cast<const TextLayer*>(layer.get());
@@ -279,9 +277,9 @@ std::unique_ptr<Document> load(const std::string& path) {
                 auto tile = std::make_unique<Tile>();
                 reader.readBytes(tile->pixels, sizeof(tile->pixels));
 
-                u64 key = makeTileKey(tileX, tileY);
-                pixel->canvas.tiles[key] = std::move(tile);
+                pixel->canvas.setTile(tileX, tileY, std::move(tile));
             }
+            pixel->canvas.compactSolidTiles();
             layer = std::move(pixel);
         }
         else if (layerType == 1) {
@@ -0,0 +1,235 @@
+#include "rect_region.h"
+#include <limits>
+#include <utility>
+
+namespace {
+
+i64 rectArea(const Recti& r) {
+    return static_cast<i64>(r.w) * r.h;
+}
+
+Recti boundingRect(const Recti& a, const Recti& b) {
+    i32 x0 = std::min(a.x, b.x);
+    i32 y0 = std::min(a.y, b.y);
+    i32 x1 = std::max(a.x + a.w, b.x + b.w);
+    i32 y1 = std::max(a.y + a.h, b.y + b.h);
+    return Recti(x0, y0, x1 - x0, y1 - y0);
+}
+
+// One past the last rect of the band starting at rects[first]
+size_t bandEnd(const std::vector<Recti>& rects, size_t first) {
+    size_t end = first + 1;
+    while (end < rects.size() && rects[end].y == rects[first].y) ++end;
+    return end;
+}
+
+// Spans are flat [x0, x1) pairs, sorted and separated by gaps
+void bandSpans(const std::vector<Recti>& rects, size_t first, size_t end, std::vector<i32>& spans) {
+    spans.clear();
+    for (size_t i = first; i < end; ++i) {
+        spans.push_back(rects[i].x);
+        spans.push_back(rects[i].x + rects[i].w);
+    }
+}
+
+void uniteSpans(const std::vector<i32>& a, const std::vector<i32>& b, std::vector<i32>& out) {
+    out.clear();
+    size_t ia = 0, ib = 0;
+    while (ia < a.size() || ib < b.size()) {
+        i32 x0, x1;
+        if (ib >= b.size() || (ia < a.size() && a[ia] <= b[ib])) {
+            x0 = a[ia]; x1 = a[ia + 1]; ia += 2;
+        } else {
+            x0 = b[ib]; x1 = b[ib + 1]; ib += 2;
+        }
+        if (!out.empty() && x0 <= out.back()) {
+            out.back() = std::max(out.back(), x1);
+        } else {
+            out.push_back(x0);
+            out.push_back(x1);
+        }
+    }
+}
+
+void intersectSpans(const std::vector<i32>& a, const std::vector<i32>& b, std::vector<i32>& out) {
+    out.clear();
+    size_t ia = 0, ib = 0;
+    while (ia < a.size() && ib < b.size()) {
+        i32 x0 = std::max(a[ia], b[ib]);
+        i32 x1 = std::min(a[ia + 1], b[ib + 1]);
+        if (x1 > x0) {
+            out.push_back(x0);
+            out.push_back(x1);
+        }
+        // Drop whichever span ends first
+        if (a[ia + 1] < b[ib + 1]) ia += 2;
+        else ib += 2;
+    }
+}
+
+} // namespace
+
+void RectRegion::clear() {
+    rects.clear();
+    extents = Recti();
+    coveredArea = 0;
+}
+
+void RectRegion::unite(const Recti& r) {
+    if (r.isEmpty()) return;
+
+    if (rects.empty()) {
+        rects.push_back(r);
+        extents = r;
+        coveredArea = rectArea(r);
+        return;
+    }
+
+    // Marking the same area again is common; skip the rebuild
+    for (const Recti& existing : rects) {
+        if (r.x >= existing.x && r.y >= existing.y &&
+            r.x + r.w <= existing.x + existing.w && r.y + r.h <= existing.y + existing.h) {
+            return;
+        }
+    }
+
+    RectRegion result;
+    combine(*this, RectRegion(r), Op::Union, result);
+    *this = std::move(result);
+}
+
+void RectRegion::unite(const RectRegion& other) {
+    if (other.isEmpty()) return;
+    if (isEmpty()) {
+        *this = other;
+        return;
+    }
+
+    RectRegion result;
+    combine(*this, other, Op::Union, result);
+    *this = std::move(result);
+}
+
+void RectRegion::intersect(const Recti& r) {
+    if (isEmpty()) return;
+    if (r.isEmpty() || !r.intersects(extents)) {
+        clear();
+        return;
+    }
+    if (r.intersection(extents) == extents) return;
+
+    RectRegion result;
+    combine(*this, RectRegion(r), Op::Intersect, result);
+    *this = std::move(result);
+}
+
+void RectRegion::simplify(u32 maxRects) {
+    if (maxRects == 0) maxRects = 1;
+    if (rects.size() <= maxRects) return;
+
+    // Merging two rects into their bounding box can split the bands around
+    // it, so rebuild the region after each merge and check the real count
+    std::vector<Recti> pieces = rects;
+    while (pieces.size() > 1) {
+        size_t bestA = 0, bestB = 1;
+        i64 bestCost = std::numeric_limits<i64>::max();
+        for (size_t a = 0; a < pieces.size(); ++a) {
+            for (size_t b = a + 1; b < pieces.size(); ++b) {
+                i64 cost = rectArea(boundingRect(pieces[a], pieces[b])) -
+                           rectArea(pieces[a]) - rectArea(pieces[b]) +
+                           rectArea(pieces[a].intersection(pieces[b]));
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+        pieces[bestA] = boundingRect(pieces[bestA], pieces[bestB]);
+        pieces.erase(pieces.begin() + bestB);
+
+        RectRegion merged;
+        for (const Recti& piece : pieces) {
+            merged.unite(piece);
+        }
+        if (merged.rectCount() <= maxRects) {
+            *this = std::move(merged);
+            return;
+        }
+    }
+}
+
+void RectRegion::combine(const RectRegion& a, const RectRegion& b, Op op, RectRegion& out) {
+    out.rects.clear();
+    const std::vector<Recti>& ra = a.rects;
+    const std::vector<Recti>& rb = b.rects;
+    std::vector<i32> spansA, spansB, spans;
+    size_t lastBand = 0;
+    size_t ia = 0, ib = 0;
+    i32 y = std::numeric_limits<i32>::min();
+
+    // Walk down both band lists at once. Each step covers the rows up to the
+    // next place either region starts or ends a band.
+    while (ia < ra.size() || ib < rb.size()) {
+        i32 topA = ia < ra.size() ? ra[ia].y : std::numeric_limits<i32>::max();
+        i32 topB = ib < rb.size() ? rb[ib].y : std::numeric_limits<i32>::max();
+        y = std::max(y, std::min(topA, topB));
+
+        bool inA = topA <= y;
+        bool inB = topB <= y;
+        i32 bottomA = inA ? topA + ra[ia].h : topA;
+        i32 bottomB = inB ? topB + rb[ib].h : topB;
+        i32 bottom = std::min(bottomA, bottomB);
+
+        size_t endA = inA ? bandEnd(ra, ia) : ia;
+        size_t endB = inB ? bandEnd(rb, ib) : ib;
+        bandSpans(ra, ia, endA, spansA);
+        bandSpans(rb, ib, endB, spansB);
+        if (op == Op::Union) uniteSpans(spansA, spansB, spans);
+        else intersectSpans(spansA, spansB, spans);
+        out.appendBand(y, bottom, spans, lastBand);
+
+        y = bottom;
+        if (inA && bottomA == bottom) ia = endA;
+        if (inB && bottomB == bottom) ib = endB;
+    }
+
+    out.updateExtents();
+}
+
+void RectRegion::appendBand(i32 top, i32 bottom, const std::vector<i32>& spans, size_t& lastBand) {
+    if (spans.empty()) return;
+
+    if (!rects.empty()) {
+        const Recti& above = rects[lastBand];
+        bool sameSpans = above.y + above.h == top && (rects.size() - lastBand) * 2 == spans.size();
+        for (size_t i = lastBand; sameSpans && i < rects.size(); ++i) {
+            size_t s = (i - lastBand) * 2;
+            sameSpans = rects[i].x == spans[s] && rects[i].x + rects[i].w == spans[s + 1];
+        }
+        if (sameSpans) {
+            for (size_t i = lastBand; i < rects.size(); ++i) {
+                rects[i].h += bottom - top;
+            }
+            return;
+        }
+    }
+
+    lastBand = rects.size();
+    for (size_t s = 0; s < spans.size(); s += 2) {
+        rects.push_back(Recti(spans[s], top, spans[s + 1] - spans[s], bottom - top));
+    }
+}
+
+void RectRegion::updateExtents() {
+    coveredArea = 0;
+    if (rects.empty()) {
+        extents = Recti();
+        return;
+    }
+    extents = rects.front();
+    for (const Recti& r : rects) {
+        extents = boundingRect(extents, r);
+        coveredArea += rectArea(r);
+    }
+}
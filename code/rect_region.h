@@ -0,0 +1,53 @@
+#ifndef _H_RECT_REGION_
+#define _H_RECT_REGION_
+
+#include "types.h"
+#include "primitives.h"
+#include <vector>
+
+// Set of pixels stored as non-overlapping rectangles in y-x bands, the way
+// X11 regions are: rects are sorted by top edge, rects in the same band share
+// top and bottom and are sorted by x with a gap between neighbours, and two
+// touching bands never have the same spans (they are merged into one). Every
+// shape therefore has one representation, and the rects can be drawn and
+// presented one by one without touching a pixel twice.
+class RectRegion {
+public:
+    RectRegion() = default;
+    explicit RectRegion(const Recti& r) { unite(r); }
+
+    bool isEmpty() const { return rects.empty(); }
+    u32 rectCount() const { return static_cast<u32>(rects.size()); }
+    const Recti* data() const { return rects.data(); }
+    std::vector<Recti>::const_iterator begin() const { return rects.begin(); }
+    std::vector<Recti>::const_iterator end() const { return rects.end(); }
+
+    // Bounding rect (empty for an empty region)
+    const Recti& bounds() const { return extents; }
+    // Number of pixels covered
+    i64 area() const { return coveredArea; }
+
+    void clear();
+    void unite(const Recti& r);
+    void unite(const RectRegion& other);
+    void intersect(const Recti& r);
+
+    // Cover a little more than needed to get down to maxRects rects: the
+    // rects whose bounding box adds the fewest pixels are merged first.
+    void simplify(u32 maxRects);
+
+private:
+    enum class Op { Union, Intersect };
+
+    std::vector<Recti> rects;
+    Recti extents;
+    i64 coveredArea = 0;
+
+    static void combine(const RectRegion& a, const RectRegion& b, Op op, RectRegion& out);
+    // Append a band below the rects already in out, merging it into the
+    // band above when that one touches it and has the same spans
+    void appendBand(i32 top, i32 bottom, const std::vector<i32>& spans, size_t& lastBand);
+    void updateExtents();
+};
+
+#endif
@@ -65,12 +65,7 @@ void CloneTool::onMouseDown(Document& doc, const ToolEvent& e) {
     strokeSelection = doc.selection.hasSelection ? &doc.selection : nullptr;
 
     // Create snapshot of the layer so we sample from original pixels, not newly cloned ones
-    sourceSnapshot = std::make_unique<TiledCanvas>(layer->canvas.width, layer->canvas.height);
-    layer->canvas.forEachPixel([this](u32 x, u32 y, u32 pixel) {
-        if (pixel & 0xFF) {  // Has alpha
-            sourceSnapshot->setPixel(x, y, pixel);
-        }
-    });
+    sourceSnapshot = layer->canvas.clone();
 
     // Capture tiles before modifying
     f32 size = state.brushSize;
@@ -231,6 +226,8 @@ void CloneTool::cloneAt(TiledCanvas& canvas, const Vec2& destPos, f32 pressure,
     i32 srcStartX = static_cast<i32>(srcLayerPos.x - stamp.size / 2.0f);
     i32 srcStartY = static_cast<i32>(srcLayerPos.y - stamp.size / 2.0f);
 
+    TileReader sourceReader(*sourceSnapshot);
+    TileWriter writer(canvas);
     for (u32 by = 0; by < stamp.size; ++by) {
         for (u32 bx = 0; bx < stamp.size; ++bx) {
             f32 brushAlpha = stamp.getAlpha(bx, by);
@@ -246,7 +243,7 @@ void CloneTool::cloneAt(TiledCanvas& canvas, const Vec2& destPos, f32 pressure,
 
             // Read from snapshot (original pixels), not the live canvas
             // TiledCanvas handles any coordinates - returns 0 for non-existent tiles
-            u32 srcPixel = sourceSnapshot->getPixel(sx, sy);
+            u32 srcPixel = sourceReader.getPixel(sx, sy);
             if ((srcPixel & 0xFF) == 0) continue;  // Skip transparent source pixels
 
             f32 finalAlpha = brushAlpha * opacity * flow;
@@ -255,7 +252,7 @@ void CloneTool::cloneAt(TiledCanvas& canvas, const Vec2& destPos, f32 pressure,
             Blend::unpack(srcPixel, r, g, b, a);
             u32 stampColor = Blend::pack(r, g, b, static_cast<u8>(a * finalAlpha));
 
-            canvas.blendPixel(dx, dy, stampColor);
+            writer.blendPixel(dx, dy, stampColor);
         }
     }
 }
@@ -391,12 +388,13 @@ void SmudgeTool::sampleCarriedColors(TiledCanvas& canvas, const Vec2& layerPos)
     i32 startX = static_cast<i32>(layerPos.x - stamp.size / 2.0f);
     i32 startY = static_cast<i32>(layerPos.y - stamp.size / 2.0f);
 
+    TileReader reader(canvas);
     for (u32 by = 0; by < stamp.size; ++by) {
         for (u32 bx = 0; bx < stamp.size; ++bx) {
             i32 x = startX + bx;
             i32 y = startY + by;
             // TiledCanvas handles any coordinates - returns 0 for non-existent tiles
-            carriedColors[by * carriedSize + bx] = canvas.getPixel(x, y);
+            carriedColors[by * carriedSize + bx] = reader.getPixel(x, y);
         }
     }
 }
@@ -437,6 +435,7 @@ void SmudgeTool::smudgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressur
     i32 startX = static_cast<i32>(layerPos.x - stamp.size / 2.0f);
     i32 startY = static_cast<i32>(layerPos.y - stamp.size / 2.0f);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < stamp.size; ++by) {
         for (u32 bx = 0; bx < stamp.size; ++bx) {
             f32 brushAlpha = stamp.getAlpha(bx, by);
@@ -462,7 +461,7 @@ void SmudgeTool::smudgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressur
             if (carriedIdx >= carriedColors.size()) continue;
 
             u32 carriedPixel = carriedColors[carriedIdx];
-            u32 destPixel = canvas.getPixel(x, y);
+            u32 destPixel = writer.getPixel(x, y);
 
             // Unpack colors
             u8 cr, cg, cb, ca;
@@ -477,7 +476,7 @@ void SmudgeTool::smudgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressur
             u8 nb = static_cast<u8>(db + (cb - db) * t);
             u8 na = static_cast<u8>(da + (ca - da) * t);
 
-            canvas.setPixel(x, y, Blend::pack(nr, ng, nb, na));
+            writer.setPixel(x, y, Blend::pack(nr, ng, nb, na));
 
             // Pick up some destination color into carried buffer
             f32 p = pickupRate * brushAlpha;
@@ -639,6 +638,7 @@ void DodgeTool::dodgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure)
     i32 startX = static_cast<i32>(layerPos.x - stamp.size / 2.0f);
     i32 startY = static_cast<i32>(layerPos.y - stamp.size / 2.0f);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < stamp.size; ++by) {
         for (u32 bx = 0; bx < stamp.size; ++bx) {
             f32 brushAlpha = stamp.getAlpha(bx, by);
@@ -650,7 +650,7 @@ void DodgeTool::dodgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure)
             // Check selection mask
             if (!isInSelection(strokeSelection, x, y, layerToDocTransform)) continue;
 
-            u32 pixel = canvas.getPixel(x, y);
+            u32 pixel = writer.getPixel(x, y);
             u8 r, g, b, a;
             Blend::unpack(pixel, r, g, b, a);
 
@@ -663,7 +663,7 @@ void DodgeTool::dodgeAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure)
             g = static_cast<u8>(std::min(255.0f, g + (255 - g) * amount));
             b = static_cast<u8>(std::min(255.0f, b + (255 - b) * amount));
 
-            canvas.setPixel(x, y, Blend::pack(r, g, b, a));
+            writer.setPixel(x, y, Blend::pack(r, g, b, a));
         }
     }
 }
@@ -817,6 +817,7 @@ void BurnTool::burnAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure) {
     i32 startX = static_cast<i32>(layerPos.x - stamp.size / 2.0f);
     i32 startY = static_cast<i32>(layerPos.y - stamp.size / 2.0f);
 
+    TileWriter writer(canvas);
     for (u32 by = 0; by < stamp.size; ++by) {
         for (u32 bx = 0; bx < stamp.size; ++bx) {
             f32 brushAlpha = stamp.getAlpha(bx, by);
@@ -828,7 +829,7 @@ void BurnTool::burnAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure) {
             // Check selection mask
             if (!isInSelection(strokeSelection, x, y, layerToDocTransform)) continue;
 
-            u32 pixel = canvas.getPixel(x, y);
+            u32 pixel = writer.getPixel(x, y);
             u8 r, g, b, a;
             Blend::unpack(pixel, r, g, b, a);
 
@@ -841,7 +842,7 @@ void BurnTool::burnAt(TiledCanvas& canvas, const Vec2& layerPos, f32 pressure) {
             g = static_cast<u8>(std::max(0.0f, g - g * amount));
             b = static_cast<u8>(std::max(0.0f, b - b * amount));
 
-            canvas.setPixel(x, y, Blend::pack(r, g, b, a));
+            writer.setPixel(x, y, Blend::pack(r, g, b, a));
         }
     }
 }
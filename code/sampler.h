@@ -6,6 +6,7 @@
 #include "tiled_canvas.h"
 #include "blend.h"
 #include <cmath>
+#include <algorithm>
 
 enum class SampleMode {
     Nearest,
@@ -22,25 +23,8 @@ namespace Sampler {
         return canvas.getPixel(ix, iy);
     }
 
-    // Bilinear interpolation (transparent outside bounds)
-    inline u32 sampleBilinear(const TiledCanvas& canvas, f32 x, f32 y) {
-        f32 fx = std::floor(x);
-        f32 fy = std::floor(y);
-        f32 tx = x - fx;
-        f32 ty = y - fy;
-
-        i32 x0 = static_cast<i32>(fx);
-        i32 y0 = static_cast<i32>(fy);
-        i32 x1 = x0 + 1;
-        i32 y1 = y0 + 1;
-
-        // TiledCanvas handles any coordinates - returns 0 for non-existent tiles
-        u32 c00 = canvas.getPixel(x0, y0);
-        u32 c10 = canvas.getPixel(x1, y0);
-        u32 c01 = canvas.getPixel(x0, y1);
-        u32 c11 = canvas.getPixel(x1, y1);
-
-        // Interpolate each channel
+    // Weighted average of a 2x2 block of pixels at fraction (tx, ty) from c00
+    inline u32 bilinear(u32 c00, u32 c10, u32 c01, u32 c11, f32 tx, f32 ty) {
         u8 r00, g00, b00, a00;
         u8 r10, g10, b10, a10;
         u8 r01, g01, b01, a01;
@@ -67,6 +51,43 @@ namespace Sampler {
         );
     }
 
+    // Bilinear interpolation (transparent outside bounds)
+    inline u32 sampleBilinear(const TiledCanvas& canvas, f32 x, f32 y) {
+        f32 fx = std::floor(x);
+        f32 fy = std::floor(y);
+        f32 tx = x - fx;
+        f32 ty = y - fy;
+
+        i32 x0 = static_cast<i32>(fx);
+        i32 y0 = static_cast<i32>(fy);
+        i32 x1 = x0 + 1;
+        i32 y1 = y0 + 1;
+
+        u32 c00, c10, c01, c11;
+        u32 localX = floorMod(x0, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(y0, static_cast<i32>(Config::TILE_SIZE));
+        if (localX + 1 < Config::TILE_SIZE && localY + 1 < Config::TILE_SIZE) {
+            // All four taps fall inside one tile - look it up once
+            const Tile* tile = canvas.getTile(floorDiv(x0, static_cast<i32>(Config::TILE_SIZE)),
+                                              floorDiv(y0, static_cast<i32>(Config::TILE_SIZE)));
+            if (!tile) return 0;
+            if (tile->solid) return tile->solidColor;
+            const u32* row = tile->pixels + localY * Config::TILE_SIZE + localX;
+            c00 = row[0];
+            c10 = row[1];
+            c01 = row[Config::TILE_SIZE];
+            c11 = row[Config::TILE_SIZE + 1];
+        } else {
+            // TiledCanvas handles any coordinates - returns 0 for non-existent tiles
+            c00 = canvas.getPixel(x0, y0);
+            c10 = canvas.getPixel(x1, y0);
+            c01 = canvas.getPixel(x0, y1);
+            c11 = canvas.getPixel(x1, y1);
+        }
+
+        return bilinear(c00, c10, c01, c11, tx, ty);
+    }
+
     // Bicubic interpolation weight function
     inline f32 cubicWeight(f32 t) {
         f32 at = std::abs(t);
@@ -86,6 +107,20 @@ namespace Sampler {
 
         f32 r = 0, g = 0, b = 0, a = 0;
 
+        // Read the 4x4 neighbourhood straight from the tile when it does not
+        // cross a tile edge
+        const u32* block = nullptr;
+        u32 localX = floorMod(ix, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(iy, static_cast<i32>(Config::TILE_SIZE));
+        if (localX >= 1 && localX + 2 < Config::TILE_SIZE &&
+            localY >= 1 && localY + 2 < Config::TILE_SIZE) {
+            const Tile* tile = canvas.getTile(floorDiv(ix, static_cast<i32>(Config::TILE_SIZE)),
+                                              floorDiv(iy, static_cast<i32>(Config::TILE_SIZE)));
+            if (!tile) return 0;
+            if (tile->solid) return tile->solidColor;
+            block = tile->pixels + localY * Config::TILE_SIZE + localX;
+        }
+
         for (i32 dy = -1; dy <= 2; ++dy) {
             f32 wy = cubicWeight(fy - dy);
             for (i32 dx = -1; dx <= 2; ++dx) {
@@ -96,7 +131,8 @@ namespace Sampler {
                 i32 sy = iy + dy;
 
                 // TiledCanvas handles any coordinates - returns 0 for non-existent tiles
-                u32 pixel = canvas.getPixel(sx, sy);
+                u32 pixel = block ? block[dy * static_cast<i32>(Config::TILE_SIZE) + dx]
+                                  : canvas.getPixel(sx, sy);
 
                 u8 pr, pg, pb, pa;
                 Blend::unpack(pixel, pr, pg, pb, pa);
@@ -127,4 +163,124 @@ namespace Sampler {
     }
 }
 
+// Bilinear samples of a canvas under rows of document pixels, for drawing a
+// canvas through an affine transform. The canvas position is stepped along
+// the row instead of transformed per pixel, the part of the row that can't
+// reach the canvas's tiles is cut off up front, and the 2x2 block of tiles
+// around the current sample is kept between samples.
+class AffineSampler {
+public:
+    // docToCanvas maps document coordinates to canvas coordinates. bounds is
+    // the area holding the canvas's tiles (TiledCanvas::getBounds()).
+    AffineSampler(const TiledCanvas& canvas, const Matrix3x2& docToCanvas, const Recti& bounds)
+        : canvas(&canvas), matrix(docToCanvas), bounds(bounds) {}
+
+    // Canvas position of document point (x, y); each pixel right adds step()
+    Vec2 start(f32 x, f32 y) const { return matrix.transform(Vec2(x, y)); }
+    Vec2 step() const { return Vec2(matrix.m[0], matrix.m[1]); }
+
+    // Samples for document pixels (docX + i, docY), i < count
+    void sampleRow(f32 docX, f32 docY, u32 count, u32* out) {
+        Vec2 origin = start(docX, docY);
+        Vec2 delta = step();
+
+        // A bilinear sample only reads tiles when its top-left tap lies in
+        // [bounds.x - 1, bounds.x + bounds.w) (likewise for y). Solve for the
+        // pixels that can get there, one pixel wider each side for rounding.
+        f32 first = 0.0f, last = static_cast<f32>(count);
+        clipAxis(origin.x, delta.x, static_cast<f32>(bounds.x - 1),
+                 static_cast<f32>(bounds.x + bounds.w), first, last);
+        clipAxis(origin.y, delta.y, static_cast<f32>(bounds.y - 1),
+                 static_cast<f32>(bounds.y + bounds.h), first, last);
+        u32 begin = 0, end = 0;
+        if (bounds.w > 0 && bounds.h > 0 && first < last) {
+            begin = first > 1.0f ? static_cast<u32>(first) - 1 : 0;
+            end = last + 1.0f < static_cast<f32>(count) ? static_cast<u32>(last) + 1 : count;
+        }
+
+        std::fill(out, out + begin, 0u);
+        for (u32 i = begin; i < end; ++i) {
+            f32 fi = static_cast<f32>(i);
+            out[i] = sample(origin.x + fi * delta.x, origin.y + fi * delta.y);
+        }
+        std::fill(out + end, out + count, 0u);
+    }
+
+    // Bilinear sample at canvas position (x, y), same as Sampler::sampleBilinear
+    u32 sample(f32 x, f32 y) {
+        f32 fx = std::floor(x);
+        f32 fy = std::floor(y);
+        i32 x0 = static_cast<i32>(fx);
+        i32 y0 = static_cast<i32>(fy);
+
+        u32 c00, c10, c01, c11;
+        u32 localX = floorMod(x0, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(y0, static_cast<i32>(Config::TILE_SIZE));
+        if (localX + 1 < Config::TILE_SIZE && localY + 1 < Config::TILE_SIZE) {
+            const Tile* tile = tileAt(floorDiv(x0, static_cast<i32>(Config::TILE_SIZE)),
+                                      floorDiv(y0, static_cast<i32>(Config::TILE_SIZE)));
+            if (!tile) return 0;
+            if (tile->solid) return tile->solidColor;
+            const u32* row = tile->pixels + localY * Config::TILE_SIZE + localX;
+            c00 = row[0];
+            c10 = row[1];
+            c01 = row[Config::TILE_SIZE];
+            c11 = row[Config::TILE_SIZE + 1];
+        } else {
+            c00 = pixelAt(x0, y0);
+            c10 = pixelAt(x0 + 1, y0);
+            c01 = pixelAt(x0, y0 + 1);
+            c11 = pixelAt(x0 + 1, y0 + 1);
+        }
+        return Sampler::bilinear(c00, c10, c01, c11, x - fx, y - fy);
+    }
+
+private:
+    // Narrow [first, last) to the pixels i with lo <= origin + i * delta < hi
+    static void clipAxis(f32 origin, f32 delta, f32 lo, f32 hi, f32& first, f32& last) {
+        if (delta == 0.0f) {
+            if (origin < lo || origin >= hi) last = 0.0f;
+            return;
+        }
+        f32 a = (lo - origin) / delta;
+        f32 b = (hi - origin) / delta;
+        if (a > b) std::swap(a, b);
+        first = std::max(first, std::ceil(a));
+        last = std::min(last, std::floor(b) + 1.0f);
+    }
+
+    // Tiles cached by the parity of their coordinates, so the four tiles a
+    // sample can straddle never evict each other
+    const Tile* tileAt(i32 tileX, i32 tileY) {
+        Slot& slot = slots[(tileX & 1) | ((tileY & 1) << 1)];
+        if (!slot.loaded || slot.tileX != tileX || slot.tileY != tileY) {
+            slot.tileX = tileX;
+            slot.tileY = tileY;
+            slot.tile = canvas->getTile(tileX, tileY);
+            slot.loaded = true;
+        }
+        return slot.tile;
+    }
+
+    u32 pixelAt(i32 x, i32 y) {
+        const Tile* tile = tileAt(floorDiv(x, static_cast<i32>(Config::TILE_SIZE)),
+                                  floorDiv(y, static_cast<i32>(Config::TILE_SIZE)));
+        if (!tile) return 0;
+        return tile->getPixel(floorMod(x, static_cast<i32>(Config::TILE_SIZE)),
+                              floorMod(y, static_cast<i32>(Config::TILE_SIZE)));
+    }
+
+    struct Slot {
+        i32 tileX = 0;
+        i32 tileY = 0;
+        const Tile* tile = nullptr;
+        bool loaded = false;
+    };
+
+    const TiledCanvas* canvas;
+    Matrix3x2 matrix;
+    Recti bounds;
+    Slot slots[4];
+};
+
 #endif
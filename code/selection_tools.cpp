@@ -295,11 +295,13 @@ void MagicWandTool::floodSelect(Selection& sel, const TiledCanvas& canvas,
     queue.push({startX, startY});
     visited[startY * w + startX] = true;
 
+    TileReader reader(canvas);
+
     while (!queue.empty()) {
         auto [x, y] = queue.front();
         queue.pop();
 
-        u32 currentColor = canvas.getPixel(x, y);
+        u32 currentColor = reader.getPixel(x, y);
         if (colorDifference(currentColor, targetColor) > tolerance) continue;
 
         if (subtract) {
@@ -318,7 +320,7 @@ void MagicWandTool::floodSelect(Selection& sel, const TiledCanvas& canvas,
             if (nx >= 0 && ny >= 0 && nx < static_cast<i32>(w) && ny < static_cast<i32>(h)) {
                 i32 idx = ny * w + nx;
                 if (!visited[idx]) {
-                    u32 neighborColor = canvas.getPixel(nx, ny);
+                    u32 neighborColor = reader.getPixel(nx, ny);
                     if (colorDifference(neighborColor, targetColor) <= tolerance) {
                         visited[idx] = true;
                         queue.push({nx, ny});
@@ -331,9 +333,10 @@ void MagicWandTool::floodSelect(Selection& sel, const TiledCanvas& canvas,
 
 void MagicWandTool::globalSelect(Selection& sel, const TiledCanvas& canvas,
                                  u32 targetColor, f32 tolerance, bool add, bool subtract) {
+    TileReader reader(canvas);
     for (u32 y = 0; y < canvas.height; ++y) {
         for (u32 x = 0; x < canvas.width; ++x) {
-            u32 currentColor = canvas.getPixel(x, y);
+            u32 currentColor = reader.getPixel(x, y);
             if (colorDifference(currentColor, targetColor) <= tolerance) {
                 if (subtract) {
                     sel.setValue(x, y, 0);
@@ -378,11 +381,13 @@ void MagicWandTool::floodSelectTransformed(Selection& sel, const TiledCanvas& ca
     queue.push({startX, startY});
     visited.insert(packCoord(startX, startY));
 
+    TileReader reader(canvas);
+
     while (!queue.empty()) {
         auto [x, y] = queue.front();
         queue.pop();
 
-        u32 currentColor = canvas.getPixel(x, y);
+        u32 currentColor = reader.getPixel(x, y);
         if (colorDifference(currentColor, targetColor) > tolerance) continue;
 
         // Transform layer coords to document coords for selection
@@ -413,7 +418,7 @@ void MagicWandTool::floodSelectTransformed(Selection& sel, const TiledCanvas& ca
             u64 key = packCoord(nx, ny);
             if (visited.find(key) != visited.end()) continue;
 
-            u32 neighborColor = canvas.getPixel(nx, ny);
+            u32 neighborColor = reader.getPixel(nx, ny);
             if (colorDifference(neighborColor, targetColor) <= tolerance) {
                 visited.insert(key);
                 queue.push({nx, ny});
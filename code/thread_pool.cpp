@@ -0,0 +1,116 @@
+#include "thread_pool.h"
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool;
+    return pool;
+}
+
+#ifdef __EMSCRIPTEN__
+
+ThreadPool::ThreadPool() {}
+ThreadPool::~ThreadPool() {}
+
+u32 ThreadPool::getThreadCount() const {
+    return 1;
+}
+
+void ThreadPool::parallelFor(u32 count, const std::function<void(u32 index)>& job) {
+    for (u32 i = 0; i < count; ++i) {
+        job(i);
+    }
+}
+
+#else
+
+ThreadPool::ThreadPool() {
+    // Leave one hardware thread for the caller, which also runs jobs
+    u32 hardwareThreads = std::thread::hardware_concurrency();
+    u32 workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+
+    workers.reserve(workerCount);
+    for (u32 i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+u32 ThreadPool::getThreadCount() const {
+    return static_cast<u32>(workers.size()) + 1;
+}
+
+void ThreadPool::parallelFor(u32 count, const std::function<void(u32 index)>& job) {
+    if (count == 0) return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Run inline when there is nothing to share, or when called re-entrantly
+    // (from a job, or while another thread owns the pool)
+    if (workers.empty() || count == 1 || busy) {
+        lock.unlock();
+        for (u32 i = 0; i < count; ++i) {
+            job(i);
+        }
+        return;
+    }
+
+    busy = true;
+    currentJob = &job;
+    jobCount = count;
+    nextJob = 0;
+    jobsRemaining = count;
+    lock.unlock();
+    wakeCondition.notify_all();
+
+    // The caller works through the batch too
+    runJobs();
+
+    lock.lock();
+    doneCondition.wait(lock, [this]() { return jobsRemaining == 0; });
+    currentJob = nullptr;
+    busy = false;
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [this]() {
+                return stopping || (currentJob && nextJob < jobCount);
+            });
+            if (stopping) return;
+        }
+        runJobs();
+    }
+}
+
+void ThreadPool::runJobs() {
+    for (;;) {
+        const std::function<void(u32)>* job;
+        u32 index;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!currentJob || nextJob >= jobCount) return;
+            job = currentJob;
+            index = nextJob++;
+        }
+
+        (*job)(index);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--jobsRemaining == 0) {
+            doneCondition.notify_all();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _H_THREAD_POOL_
+#define _H_THREAD_POOL_
+
+#include "types.h"
+#include <functional>
+#include <vector>
+
+#ifndef __EMSCRIPTEN__
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// Fixed pool of worker threads for data-parallel loops (viewport compositing).
+// parallelFor() runs job(0..count-1) across the workers and the calling thread
+// and returns once every job has finished. Jobs must write disjoint outputs.
+// WASM builds have no threads and run every job inline.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+
+    // Number of threads that take part in parallelFor (workers + caller)
+    u32 getThreadCount() const;
+
+    void parallelFor(u32 count, const std::function<void(u32 index)>& job);
+
+private:
+    ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+#ifndef __EMSCRIPTEN__
+    void workerLoop();
+    void runJobs();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    // Current batch (guarded by mutex)
+    const std::function<void(u32)>* currentJob = nullptr;
+    u32 jobCount = 0;
+    u32 nextJob = 0;
+    u32 jobsRemaining = 0;
+    bool busy = false;
+    bool stopping = false;
+#endif
+};
+
+#endif
@@ -1,3 +1,40 @@
 #include "tile.h"
+#include "tile_pool.h"
 
 // Tile implementation is mostly in header for inlining
+
+void* Tile::operator new(size_t size) {
+    (void)size;
+    void* block = TilePool::instance().allocate(true);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void Tile::operator delete(void* block) {
+    TilePool::instance().release(block);
+}
+
+std::unique_ptr<Tile> Tile::createUninitialized() {
+    void* block = TilePool::instance().allocate(false);
+    if (!block) throw std::bad_alloc();
+    return std::unique_ptr<Tile>(new (block) Tile());
+}
+
+TileCoverage Tile::scanCoverage() const {
+    if (solid) {
+        u32 alpha = solidColor & 0xFF;
+        return alpha == 0 ? TileCoverage::Transparent
+             : alpha == 0xFF ? TileCoverage::Opaque : TileCoverage::Mixed;
+    }
+
+    // AND and OR of every alpha: all 255 leaves the AND at 255, all 0 leaves
+    // the OR at 0
+    u32 all = 0xFF, any = 0;
+    for (u32 i = 0; i < Config::TILE_SIZE * Config::TILE_SIZE; ++i) {
+        all &= pixels[i];
+        any |= pixels[i];
+    }
+    if ((any & 0xFF) == 0) return TileCoverage::Transparent;
+    if ((all & 0xFF) == 0xFF) return TileCoverage::Opaque;
+    return TileCoverage::Mixed;
+}
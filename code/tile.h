@@ -5,13 +5,43 @@
 #include "config.h"
 #include <cstring>
 #include <memory>
+#include <atomic>
+#include <cstddef>
 
-struct Tile {
+// How much of a tile is covered, judging by alpha
+enum class TileCoverage : u8 {
+    Unknown,       // Not worked out since the tile was last written
+    Transparent,   // Every alpha is 0
+    Opaque,        // Every alpha is 255
+    Mixed
+};
+
+// Tile storage comes from TilePool (see tile_pool.h). new Tile yields a
+// cleared tile; createUninitialized() skips the clear for callers that
+// overwrite every pixel anyway.
+struct alignas(16) Tile {
     u32 pixels[Config::TILE_SIZE * Config::TILE_SIZE];
 
-    Tile() {
-        clear();
-    }
+    // Number of TileRefs pointing at this tile
+    std::atomic<u32> refCount{0};
+
+    // Every pixel is solidColor. Only set on tiles nobody writes to any more
+    // (see TiledCanvas::solidTile); makeWritable() clears it.
+    u32 solidColor = 0;
+    bool solid = false;
+
+    // Cached by getCoverage(). Writers reach pixels through
+    // TileRef::makeWritable() or hold a fresh tile, and both start it over.
+    mutable std::atomic<TileCoverage> coverage{TileCoverage::Unknown};
+
+    // Pixels are zeroed by operator new, not here
+    Tile() {}
+
+    static void* operator new(size_t size);
+    static void* operator new(size_t size, void* place) { (void)size; return place; }
+    static void operator delete(void* block);
+
+    static std::unique_ptr<Tile> createUninitialized();
 
     void clear() {
         std::memset(pixels, 0, sizeof(pixels));
@@ -25,7 +55,36 @@ struct Tile {
         pixels[localY * Config::TILE_SIZE + localX] = color;
     }
 
+    void markSolid(u32 color) {
+        solid = true;
+        solidColor = color;
+    }
+
+    // True if every pixel has the same value, which is returned in color
+    bool isUniform(u32& color) const {
+        if (solid) {
+            color = solidColor;
+            return true;
+        }
+        color = pixels[0];
+        for (u32 i = 1; i < Config::TILE_SIZE * Config::TILE_SIZE; ++i) {
+            if (pixels[i] != color) return false;
+        }
+        return true;
+    }
+
+    // Alpha coverage, scanned on first use after a write. Readers on several
+    // threads may scan at once; they store the same answer.
+    TileCoverage getCoverage() const {
+        TileCoverage known = coverage.load(std::memory_order_relaxed);
+        if (known != TileCoverage::Unknown) return known;
+        known = scanCoverage();
+        coverage.store(known, std::memory_order_relaxed);
+        return known;
+    }
+
     bool isEmpty() const {
+        if (solid) return (solidColor & 0xFF) == 0;
         for (u32 i = 0; i < Config::TILE_SIZE * Config::TILE_SIZE; ++i) {
             if ((pixels[i] & 0xFF) != 0) { // Check alpha channel
                 return false;
@@ -36,10 +95,89 @@ struct Tile {
 
     // Create a deep copy
     std::unique_ptr<Tile> clone() const {
-        auto copy = std::make_unique<Tile>();
+        auto copy = createUninitialized();
         std::memcpy(copy->pixels, pixels, sizeof(pixels));
+        copy->coverage.store(coverage.load(std::memory_order_relaxed), std::memory_order_relaxed);
         return copy;
     }
+
+private:
+    TileCoverage scanCoverage() const;
+};
+
+// Shared, reference-counted handle to a tile. Copying a TileRef shares the
+// pixels; writers go through makeWritable(), which first gives this handle a
+// private copy if any other handle still points at the same tile.
+class TileRef {
+public:
+    TileRef() = default;
+    TileRef(std::nullptr_t) {}
+
+    // Take ownership of a freshly created tile
+    TileRef(std::unique_ptr<Tile> owned) : tile(owned.release()) {
+        if (tile) tile->refCount.store(1, std::memory_order_relaxed);
+    }
+
+    TileRef(const TileRef& other) : tile(other.tile) { retain(); }
+    TileRef(TileRef&& other) noexcept : tile(other.tile) { other.tile = nullptr; }
+
+    TileRef& operator=(const TileRef& other) {
+        if (tile != other.tile) {
+            other.retain();
+            release();
+            tile = other.tile;
+        }
+        return *this;
+    }
+
+    TileRef& operator=(TileRef&& other) noexcept {
+        if (this != &other) {
+            release();
+            tile = other.tile;
+            other.tile = nullptr;
+        }
+        return *this;
+    }
+
+    ~TileRef() { release(); }
+
+    const Tile* get() const { return tile; }
+    const Tile& operator*() const { return *tile; }
+    const Tile* operator->() const { return tile; }
+    explicit operator bool() const { return tile != nullptr; }
+
+    bool isShared() const {
+        return tile && tile->refCount.load(std::memory_order_acquire) > 1;
+    }
+
+    // Mutable access, copying the tile first if it is shared
+    Tile* makeWritable() {
+        if (isShared()) {
+            *this = TileRef(tile->clone());
+        } else if (tile) {
+            tile->solid = false;
+        }
+        if (tile) tile->coverage.store(TileCoverage::Unknown, std::memory_order_relaxed);
+        return tile;
+    }
+
+    void reset() {
+        release();
+        tile = nullptr;
+    }
+
+private:
+    void retain() const {
+        if (tile) tile->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void release() {
+        if (tile && tile->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete tile;
+        }
+    }
+
+    Tile* tile = nullptr;
 };
 
 // Generate tile key from signed tile coordinates
@@ -0,0 +1,137 @@
+#include "tile_index.h"
+
+void TileIndex::setGridSize(u32 tilesX, u32 tilesY) {
+    if (tilesX == gridWidth && tilesY == gridHeight) return;
+
+    // Pull every tile out, then re-insert against the new grid
+    std::vector<Slot> entries;
+    entries.reserve(count);
+    for (u32 ty = 0; ty < gridHeight; ++ty) {
+        for (u32 tx = 0; tx < gridWidth; ++tx) {
+            TileRef& tile = grid[ty * gridWidth + tx];
+            if (tile) {
+                entries.push_back({makeTileKey(static_cast<i32>(tx), static_cast<i32>(ty)), std::move(tile)});
+            }
+        }
+    }
+    for (Slot& slot : slots) {
+        if (slot.tile) entries.push_back(std::move(slot));
+    }
+
+    grid.clear();
+    grid.resize(static_cast<size_t>(tilesX) * tilesY);
+    gridWidth = tilesX;
+    gridHeight = tilesY;
+    slots.clear();
+    overflowCount = 0;
+    count = 0;
+
+    for (Slot& entry : entries) {
+        i32 tileX, tileY;
+        extractTileCoords(entry.key, tileX, tileY);
+        put(tileX, tileY, std::move(entry.tile));
+    }
+}
+
+TileRef TileIndex::put(i32 tileX, i32 tileY, TileRef tile) {
+    TileRef previous;
+    if (static_cast<u32>(tileX) < gridWidth && static_cast<u32>(tileY) < gridHeight) {
+        TileRef& cell = grid[static_cast<u32>(tileY) * gridWidth + static_cast<u32>(tileX)];
+        previous = std::move(cell);
+        cell = std::move(tile);
+        if (previous && !cell) --count;
+        if (!previous && cell) ++count;
+        return previous;
+    }
+
+    u64 key = makeTileKey(tileX, tileY);
+    if (!tile) {
+        previous = overflowTake(key);
+        if (previous) --count;
+        return previous;
+    }
+
+    size_t before = overflowCount;
+    previous = overflowPut(key, std::move(tile));
+    count += overflowCount - before;
+    return previous;
+}
+
+void TileIndex::clear() {
+    for (auto& tile : grid) {
+        tile.reset();
+    }
+    slots.clear();
+    overflowCount = 0;
+    count = 0;
+}
+
+TileRef TileIndex::overflowPut(u64 key, TileRef tile) {
+    // Keep the load factor at or below 1/2
+    if ((overflowCount + 1) * 2 > slots.size()) {
+        std::vector<Slot> entries;
+        entries.reserve(overflowCount + 1);
+        for (Slot& slot : slots) {
+            if (slot.tile) entries.push_back(std::move(slot));
+        }
+        size_t capacity = slots.empty() ? 16 : slots.size() * 2;
+        slots.clear();
+        slots.resize(capacity);
+        overflowCount = 0;
+        for (Slot& entry : entries) {
+            overflowPut(entry.key, std::move(entry.tile));
+        }
+    }
+
+    size_t mask = slots.size() - 1;
+    for (size_t i = hashKey(key) & mask; ; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (!slot.tile) {
+            slot.key = key;
+            slot.tile = std::move(tile);
+            ++overflowCount;
+            return nullptr;
+        }
+        if (slot.key == key) {
+            TileRef previous = std::move(slot.tile);
+            slot.tile = std::move(tile);
+            return previous;
+        }
+    }
+}
+
+TileRef TileIndex::overflowTake(u64 key) {
+    if (overflowCount == 0) return nullptr;
+
+    size_t mask = slots.size() - 1;
+    size_t i = hashKey(key) & mask;
+    for (; ; i = (i + 1) & mask) {
+        if (!slots[i].tile) return nullptr;
+        if (slots[i].key == key) break;
+    }
+
+    TileRef taken = std::move(slots[i].tile);
+    --overflowCount;
+
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole so lookups never need tombstones
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; slots[j].tile; j = (j + 1) & mask) {
+        size_t home = hashKey(slots[j].key) & mask;
+        // Move the entry if its home slot is not between the hole and j (cyclically)
+        bool movable = (hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (movable) {
+            slots[hole] = std::move(slots[j]);
+            hole = j;
+        }
+    }
+    return taken;
+}
+
+void TileIndex::rebuildOverflow(std::vector<Slot>& entries) {
+    slots.clear();
+    overflowCount = 0;
+    for (Slot& entry : entries) {
+        overflowPut(entry.key, std::move(entry.tile));
+    }
+}
@@ -0,0 +1,180 @@
+#ifndef _H_TILE_INDEX_
+#define _H_TILE_INDEX_
+
+#include "types.h"
+#include "tile.h"
+#include <vector>
+#include <memory>
+
+// Map from tile coordinates to shared tile handles, used by TiledCanvas.
+// Tiles inside the canvas bounds live in a dense row-major grid of pointers,
+// so a lookup is one bounds check and one load, and iteration walks memory in
+// order. Tiles outside the bounds (layer content pushed off-canvas, canvases
+// without a size) go to a small open-addressing hash table.
+class TileIndex {
+public:
+    TileIndex() = default;
+
+    TileIndex(const TileIndex&) = delete;
+    TileIndex& operator=(const TileIndex&) = delete;
+    TileIndex(TileIndex&&) = default;
+    TileIndex& operator=(TileIndex&&) = default;
+
+    // Resize the dense grid to cover tiles [0, tilesX) x [0, tilesY).
+    // Existing tiles are kept and moved between the grid and the overflow table.
+    void setGridSize(u32 tilesX, u32 tilesY);
+
+    const Tile* find(i32 tileX, i32 tileY) const {
+        const TileRef* ref = findRef(tileX, tileY);
+        return ref ? ref->get() : nullptr;
+    }
+
+    const Tile* find(u64 key) const {
+        i32 tileX, tileY;
+        extractTileCoords(key, tileX, tileY);
+        return find(tileX, tileY);
+    }
+
+    // Writable tile (nullptr if missing). A tile shared with another canvas or
+    // an undo step is copied first.
+    Tile* findForWrite(i32 tileX, i32 tileY) {
+        TileRef* ref = const_cast<TileRef*>(findRef(tileX, tileY));
+        return ref ? ref->makeWritable() : nullptr;
+    }
+
+    // Handle to a tile, sharing its pixels (empty if missing)
+    TileRef share(i32 tileX, i32 tileY) const {
+        const TileRef* ref = findRef(tileX, tileY);
+        return ref ? *ref : TileRef();
+    }
+
+    // Store a tile (nullptr removes), returning whatever was there before
+    TileRef put(i32 tileX, i32 tileY, TileRef tile);
+
+    // Remove a tile and hand it to the caller (nullptr if there was none)
+    TileRef take(i32 tileX, i32 tileY) {
+        return put(tileX, tileY, nullptr);
+    }
+
+    bool erase(i32 tileX, i32 tileY) {
+        return static_cast<bool>(take(tileX, tileY));
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // Drop every tile (the grid keeps its size)
+    void clear();
+
+    // Visit every tile handle: callback(tileX, tileY, const TileRef&).
+    // Grid tiles come first in row-major order, then overflow tiles.
+    template<typename Func>
+    void forEachRef(Func&& callback) const {
+        if (count == 0) return;
+        for (u32 ty = 0; ty < gridHeight; ++ty) {
+            const TileRef* row = grid.data() + ty * gridWidth;
+            for (u32 tx = 0; tx < gridWidth; ++tx) {
+                if (row[tx]) callback(static_cast<i32>(tx), static_cast<i32>(ty), row[tx]);
+            }
+        }
+        for (const Slot& slot : slots) {
+            if (slot.tile) {
+                i32 tileX, tileY;
+                extractTileCoords(slot.key, tileX, tileY);
+                callback(tileX, tileY, slot.tile);
+            }
+        }
+    }
+
+    // Visit every tile: callback(tileX, tileY, const Tile&)
+    template<typename Func>
+    void forEach(Func&& callback) const {
+        forEachRef([&](i32 tileX, i32 tileY, const TileRef& ref) {
+            callback(tileX, tileY, *ref);
+        });
+    }
+
+    // Visit every tile for modification: callback(tileX, tileY, Tile&).
+    // Shared tiles are copied first.
+    template<typename Func>
+    void forEachForWrite(Func&& callback) {
+        forEachRef([&](i32 tileX, i32 tileY, const TileRef& ref) {
+            callback(tileX, tileY, *const_cast<TileRef&>(ref).makeWritable());
+        });
+    }
+
+    // Remove every tile for which pred(tileX, tileY, const Tile&) returns true
+    template<typename Pred>
+    void eraseIf(Pred&& pred) {
+        for (u32 ty = 0; ty < gridHeight; ++ty) {
+            for (u32 tx = 0; tx < gridWidth; ++tx) {
+                TileRef& tile = grid[ty * gridWidth + tx];
+                if (tile && pred(static_cast<i32>(tx), static_cast<i32>(ty), *tile)) {
+                    tile.reset();
+                    --count;
+                }
+            }
+        }
+        if (overflowCount == 0) return;
+        std::vector<Slot> kept;
+        for (Slot& slot : slots) {
+            if (!slot.tile) continue;
+            i32 tileX, tileY;
+            extractTileCoords(slot.key, tileX, tileY);
+            if (pred(tileX, tileY, *slot.tile)) {
+                --count;
+            } else {
+                kept.push_back(std::move(slot));
+            }
+        }
+        rebuildOverflow(kept);
+    }
+
+private:
+    struct Slot {
+        u64 key = 0;
+        TileRef tile;  // nullptr = free slot
+    };
+
+    static u64 hashKey(u64 key) {
+        // splitmix64 finalizer - spreads neighbouring coordinates across slots
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ull;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebull;
+        key ^= key >> 31;
+        return key;
+    }
+
+    const TileRef* findRef(i32 tileX, i32 tileY) const {
+        if (static_cast<u32>(tileX) < gridWidth && static_cast<u32>(tileY) < gridHeight) {
+            const TileRef& ref = grid[static_cast<u32>(tileY) * gridWidth + static_cast<u32>(tileX)];
+            return ref ? &ref : nullptr;
+        }
+        return overflowFind(makeTileKey(tileX, tileY));
+    }
+
+    const TileRef* overflowFind(u64 key) const {
+        if (overflowCount == 0) return nullptr;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hashKey(key) & mask; ; i = (i + 1) & mask) {
+            const Slot& slot = slots[i];
+            if (!slot.tile) return nullptr;
+            if (slot.key == key) return &slot.tile;
+        }
+    }
+
+    TileRef overflowPut(u64 key, TileRef tile);
+    TileRef overflowTake(u64 key);
+    void rebuildOverflow(std::vector<Slot>& entries);
+
+    std::vector<TileRef> grid;                // gridWidth * gridHeight, row-major
+    u32 gridWidth = 0;
+    u32 gridHeight = 0;
+
+    std::vector<Slot> slots;                  // Linear probing, power-of-two size
+    size_t overflowCount = 0;
+    size_t count = 0;                         // Grid + overflow tiles
+};
+
+#endif
@@ -0,0 +1,186 @@
+#include "tile_pool.h"
+#include "tile.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+// Blocks a thread keeps for itself before going back to the shared free list.
+// An exiting thread hands its blocks back so their slabs can still be trimmed.
+// Tiles freed on that thread afterwards (static objects at exit) go straight
+// to the shared list.
+struct TilePoolThreadCache {
+    static constexpr u32 CAPACITY = 32;
+    void* blocks[CAPACITY] = {};
+    u32 count = 0;
+    bool active = true;
+
+    ~TilePoolThreadCache() {
+        TilePool::instance().releaseBatch(blocks, count);
+        count = 0;
+        active = false;
+    }
+};
+
+static thread_local TilePoolThreadCache threadCache;
+
+TilePool& TilePool::instance() {
+    static TilePool* pool = new TilePool();
+    return *pool;
+}
+
+void* TilePool::allocate(bool zeroed) {
+    void* block = nullptr;
+    bool clean = false;
+
+    if (threadCache.count > 0) {
+        block = threadCache.blocks[--threadCache.count];
+    } else {
+        u32 capacity = threadCache.active ? TilePoolThreadCache::CAPACITY : 0;
+        block = takeRecycled(threadCache.blocks, threadCache.count, capacity);
+        if (!block) {
+            std::lock_guard<std::mutex> lock(mutex);
+            block = newSlabBlock();
+            clean = true;
+        }
+    }
+    if (!block) return nullptr;
+
+    // Recycled blocks hold whatever the previous tile left behind
+    if (zeroed && !clean) {
+        std::memset(block, 0, sizeof(Tile));
+    }
+
+    size_t inUse = ++tilesInUse;
+    size_t peak = peakTilesInUse.load(std::memory_order_relaxed);
+    while (inUse > peak && !peakTilesInUse.compare_exchange_weak(peak, inUse)) {}
+    ++allocations;
+    return block;
+}
+
+void TilePool::release(void* block) {
+    if (!block) return;
+    --tilesInUse;
+
+    if (!threadCache.active) {
+        releaseBatch(&block, 1);
+        return;
+    }
+
+    if (threadCache.count == TilePoolThreadCache::CAPACITY) {
+        // Hand the older half back so other threads can reuse it
+        u32 half = TilePoolThreadCache::CAPACITY / 2;
+        releaseBatch(threadCache.blocks, half);
+        std::memmove(threadCache.blocks, threadCache.blocks + half, (threadCache.count - half) * sizeof(void*));
+        threadCache.count -= half;
+    }
+    threadCache.blocks[threadCache.count++] = block;
+}
+
+void* TilePool::takeRecycled(void** cache, u32& cacheCount, u32 capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeList) return nullptr;
+
+    FreeBlock* block = freeList;
+    freeList = block->next;
+
+    // Take a few more while we hold the lock
+    u32 refill = capacity / 2;
+    while (freeList && cacheCount < refill) {
+        cache[cacheCount++] = freeList;
+        freeList = freeList->next;
+    }
+    return block;
+}
+
+void TilePool::releaseBatch(void** blocks, u32 count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (u32 i = 0; i < count; ++i) {
+        FreeBlock* block = static_cast<FreeBlock*>(blocks[i]);
+        block->next = freeList;
+        freeList = block;
+    }
+}
+
+void* TilePool::newSlabBlock() {
+    if (bumpNext == bumpEnd) {
+        u8* slab = static_cast<u8*>(std::calloc(TILES_PER_SLAB, sizeof(Tile)));
+        if (!slab) return nullptr;
+        slabs.insert(std::upper_bound(slabs.begin(), slabs.end(), slab), slab);
+        bumpNext = slab;
+        bumpEnd = slab + TILES_PER_SLAB * sizeof(Tile);
+    }
+    void* block = bumpNext;
+    bumpNext += sizeof(Tile);
+    return block;
+}
+
+void TilePool::trim() {
+    // The calling thread's cached blocks count as free for this
+    releaseBatch(threadCache.blocks, threadCache.count);
+    threadCache.count = 0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (slabs.empty()) return;
+
+    auto slabIndexOf = [&](const void* block) {
+        const u8* address = static_cast<const u8*>(block);
+        return static_cast<size_t>(std::upper_bound(slabs.begin(), slabs.end(), address) - slabs.begin()) - 1;
+    };
+
+    // Count free blocks per slab (recycled ones plus the unused tail of the newest slab)
+    std::vector<u32> freeCounts(slabs.size(), 0);
+    for (FreeBlock* block = freeList; block; block = block->next) {
+        ++freeCounts[slabIndexOf(block)];
+    }
+    if (bumpNext != bumpEnd) {
+        freeCounts[slabIndexOf(bumpNext)] += static_cast<u32>((bumpEnd - bumpNext) / sizeof(Tile));
+    }
+
+    std::vector<bool> releaseSlab(slabs.size(), false);
+    bool anyReleased = false;
+    for (size_t i = 0; i < slabs.size(); ++i) {
+        if (freeCounts[i] == TILES_PER_SLAB) {
+            releaseSlab[i] = true;
+            anyReleased = true;
+        }
+    }
+    if (!anyReleased) return;
+
+    // Unlink blocks that belong to released slabs
+    FreeBlock* kept = nullptr;
+    for (FreeBlock* block = freeList; block; ) {
+        FreeBlock* next = block->next;
+        if (!releaseSlab[slabIndexOf(block)]) {
+            block->next = kept;
+            kept = block;
+        }
+        block = next;
+    }
+    freeList = kept;
+
+    if (bumpNext != bumpEnd && releaseSlab[slabIndexOf(bumpNext)]) {
+        bumpNext = bumpEnd = nullptr;
+    }
+
+    std::vector<u8*> remaining;
+    for (size_t i = 0; i < slabs.size(); ++i) {
+        if (releaseSlab[i]) {
+            std::free(slabs[i]);
+        } else {
+            remaining.push_back(slabs[i]);
+        }
+    }
+    slabs.swap(remaining);
+}
+
+TilePool::Stats TilePool::getStats() const {
+    Stats stats;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.slabCount = slabs.size();
+    stats.reservedBytes = slabs.size() * TILES_PER_SLAB * sizeof(Tile);
+    stats.tilesInUse = tilesInUse.load();
+    stats.freeTiles = slabs.size() * TILES_PER_SLAB - std::min(stats.tilesInUse, slabs.size() * TILES_PER_SLAB);
+    stats.peakTilesInUse = peakTilesInUse.load();
+    stats.allocations = allocations.load();
+    return stats;
+}
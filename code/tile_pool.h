@@ -0,0 +1,69 @@
+#ifndef _H_TILE_POOL_
+#define _H_TILE_POOL_
+
+#include "types.h"
+#include <mutex>
+#include <atomic>
+#include <vector>
+
+// Process-wide allocator for Tile storage. Tiles are carved out of slabs of 64
+// and recycled through a free list, with a small per-thread cache in front so
+// worker threads rendering cache tiles rarely take the lock.
+// Slabs come from calloc, so never-used blocks are already zero and their pages
+// are only committed when first written; recycled blocks are cleared on demand.
+// The pool is never destroyed, so tiles owned by static objects can be freed
+// safely at exit.
+class TilePool {
+public:
+    static constexpr u32 TILES_PER_SLAB = 64;
+
+    struct Stats {
+        size_t slabCount = 0;        // Slabs currently reserved
+        size_t reservedBytes = 0;    // Memory held by those slabs
+        size_t tilesInUse = 0;       // Live tiles
+        size_t freeTiles = 0;        // Reserved blocks not holding a live tile
+        size_t peakTilesInUse = 0;
+        u64 allocations = 0;         // Tiles handed out since startup
+    };
+
+    static TilePool& instance();
+
+    // Get storage for one tile. Zeroed blocks read as fully transparent.
+    void* allocate(bool zeroed);
+    void release(void* block);
+
+    // Give slabs with no live tiles back to the system
+    void trim();
+
+    Stats getStats() const;
+
+private:
+    friend struct TilePoolThreadCache;
+
+    TilePool() = default;
+    TilePool(const TilePool&) = delete;
+    TilePool& operator=(const TilePool&) = delete;
+
+    // Refill the calling thread's cache from the shared free list; returns
+    // nullptr if there is nothing to recycle
+    void* takeRecycled(void** cache, u32& cacheCount, u32 capacity);
+    void releaseBatch(void** blocks, u32 count);
+
+    void* newSlabBlock();
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<u8*> slabs;          // Sorted by address
+    FreeBlock* freeList = nullptr;   // Recycled (dirty) blocks
+    u8* bumpNext = nullptr;          // Unused (zero) blocks of the newest slab
+    u8* bumpEnd = nullptr;
+
+    std::atomic<size_t> tilesInUse{0};
+    std::atomic<size_t> peakTilesInUse{0};
+    std::atomic<u64> allocations{0};
+};
+
+#endif
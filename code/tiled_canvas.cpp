@@ -1,18 +1,52 @@
 #include "tiled_canvas.h"
 #include <limits>
 #include <algorithm>
+#include <mutex>
 
 std::unique_ptr<TiledCanvas> TiledCanvas::clone() const {
     auto copy = std::make_unique<TiledCanvas>(width, height);
-    for (const auto& [key, tile] : tiles) {
-        copy->tiles[key] = tile->clone();
-    }
+    tiles.forEachRef([&](i32 tileX, i32 tileY, const TileRef& tile) {
+        copy->tiles.put(tileX, tileY, tile);
+    });
     return copy;
 }
 
+const Tile& TiledCanvas::emptyTile() {
+    static const Tile tile;
+    return tile;
+}
+
+static std::mutex solidTilesMutex;
+static std::unordered_map<u32, TileRef> solidTiles;
+
+TileRef TiledCanvas::solidTile(u32 color) {
+    std::lock_guard<std::mutex> lock(solidTilesMutex);
+    TileRef& tile = solidTiles[color];
+    if (!tile) {
+        auto newTile = Tile::createUninitialized();
+        std::fill(newTile->pixels, newTile->pixels + Config::TILE_SIZE * Config::TILE_SIZE, color);
+        newTile->markSolid(color);
+        tile = std::move(newTile);
+    }
+    return tile;
+}
+
+void TiledCanvas::releaseUnusedSolidTiles() {
+    std::lock_guard<std::mutex> lock(solidTilesMutex);
+    for (auto it = solidTiles.begin(); it != solidTiles.end(); ) {
+        // The table's own handle is the only one left
+        if (!it->second.isShared()) {
+            it = solidTiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 void TiledCanvas::resize(u32 newWidth, u32 newHeight) {
     width = newWidth;
     height = newHeight;
+    updateTileGrid();
     pruneOutOfBounds();
 }
 
@@ -23,10 +57,21 @@ void TiledCanvas::clearRect(const Recti& rect) {
     i32 endY = std::min(static_cast<i32>(height), rect.y + rect.h);
 
     for (i32 y = startY; y < endY; ++y) {
-        for (i32 x = startX; x < endX; ++x) {
-            setPixel(x, y, 0);
+        i32 x = startX;
+        while (x < endX) {
+            // Rows of missing tiles are already clear
+            i32 tileX = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
+            i32 tileY = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
+            u32 localX = floorMod(x, static_cast<i32>(Config::TILE_SIZE));
+            u32 count = std::min(Config::TILE_SIZE - localX, static_cast<u32>(endX - x));
+            if (Tile* tile = tiles.findForWrite(tileX, tileY)) {
+                u32* row = tile->pixels + floorMod(y, static_cast<i32>(Config::TILE_SIZE)) * Config::TILE_SIZE + localX;
+                std::fill(row, row + count, 0u);
+            }
+            x += static_cast<i32>(count);
         }
     }
+    touch();
 }
 
 void TiledCanvas::fill(u32 color) {
@@ -37,33 +82,97 @@ void TiledCanvas::fill(u32 color) {
 
     u32 tilesX = (width + Config::TILE_SIZE - 1) / Config::TILE_SIZE;
     u32 tilesY = (height + Config::TILE_SIZE - 1) / Config::TILE_SIZE;
+    TileRef solid = solidTile(color);
 
     for (u32 ty = 0; ty < tilesY; ++ty) {
         for (u32 tx = 0; tx < tilesX; ++tx) {
-            u64 key = makeTileKey(tx, ty);
-            auto tile = std::make_unique<Tile>();
-
             u32 startX = tx * Config::TILE_SIZE;
             u32 startY = ty * Config::TILE_SIZE;
             u32 endX = std::min(startX + Config::TILE_SIZE, width);
             u32 endY = std::min(startY + Config::TILE_SIZE, height);
 
+            // Whole tiles share the solid tile; only the right and bottom
+            // edges need pixels of their own
+            if (endX - startX == Config::TILE_SIZE && endY - startY == Config::TILE_SIZE) {
+                tiles.put(static_cast<i32>(tx), static_cast<i32>(ty), solid);
+                continue;
+            }
+
+            auto tile = std::make_unique<Tile>();
+
             for (u32 y = startY; y < endY; ++y) {
-                for (u32 x = startX; x < endX; ++x) {
-                    tile->setPixel(x - startX, y - startY, color);
-                }
+                u32* row = tile->pixels + (y - startY) * Config::TILE_SIZE;
+                std::fill(row, row + (endX - startX), color);
             }
-            tiles[key] = std::move(tile);
+            tiles.put(static_cast<i32>(tx), static_cast<i32>(ty), std::move(tile));
         }
     }
+    touch();
+}
+
+void TiledCanvas::blendCanvas(const TiledCanvas& src, BlendMode mode, f32 opacity,
+                              i32 offsetX, i32 offsetY, const Recti* clip) {
+    if (opacity <= 0.0f) return;
+    const i32 size = static_cast<i32>(Config::TILE_SIZE);
+
+    src.forEachTile([&](i32 tileX, i32 tileY, const Tile& tile) {
+        if (tile.isEmpty()) return;
+        i32 destX = tileX * size + offsetX;
+
+        for (i32 localY = 0; localY < size; ++localY) {
+            i32 destY = tileY * size + localY + offsetY;
+            if (clip && (destY < clip->y || destY >= clip->y + clip->h)) continue;
+
+            // Trim the row to the clip and to its first and last visible pixel
+            const u32* row = tile.pixels + localY * size;
+            i32 start = 0;
+            i32 end = size;
+            if (clip) {
+                start = std::max(start, clip->x - destX);
+                end = std::min(end, clip->x + clip->w - destX);
+            }
+            while (start < end && (row[start] & 0xFF) == 0) ++start;
+            while (end > start && (row[end - 1] & 0xFF) == 0) --end;
+
+            while (start < end) {
+                u32 count;
+                u32* dst = getRowForWrite(destX + start, destY, count);
+                count = std::min(count, static_cast<u32>(end - start));
+                Blend::blendSpan(dst, row + start, count, mode, opacity);
+                start += static_cast<i32>(count);
+            }
+        }
+    });
+    touch();
 }
 
 void TiledCanvas::pruneEmptyTiles() {
-    for (auto it = tiles.begin(); it != tiles.end(); ) {
-        if (it->second->isEmpty()) {
-            it = tiles.erase(it);
-        } else {
-            ++it;
+    tiles.eraseIf([](i32, i32, const Tile& tile) {
+        return tile.isEmpty();
+    });
+}
+
+void TiledCanvas::compactSolidTiles(const Recti& bounds) {
+    if (bounds.w <= 0 || bounds.h <= 0) return;
+
+    i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
+    i32 startTileX = floorDiv(bounds.x, tileSize);
+    i32 startTileY = floorDiv(bounds.y, tileSize);
+    i32 endTileX = floorDiv(bounds.x + bounds.w - 1, tileSize);
+    i32 endTileY = floorDiv(bounds.y + bounds.h - 1, tileSize);
+
+    for (i32 ty = startTileY; ty <= endTileY; ++ty) {
+        for (i32 tx = startTileX; tx <= endTileX; ++tx) {
+            const Tile* tile = tiles.find(tx, ty);
+            u32 color;
+            if (!tile || tile->solid || !tile->isUniform(color)) continue;
+
+            // Same pixels either way, so the revision stays as it is
+            if (color == 0) {
+                tiles.erase(tx, ty);
+            } else {
+                tiles.put(tx, ty, solidTile(color));
+            }
         }
     }
 }
@@ -72,15 +181,10 @@ void TiledCanvas::pruneOutOfBounds() {
     i32 maxTileX = static_cast<i32>((width + Config::TILE_SIZE - 1) / Config::TILE_SIZE);
     i32 maxTileY = static_cast<i32>((height + Config::TILE_SIZE - 1) / Config::TILE_SIZE);
 
-    for (auto it = tiles.begin(); it != tiles.end(); ) {
-        i32 tileX, tileY;
-        extractTileCoords(it->first, tileX, tileY);
-        if (tileX < 0 || tileY < 0 || tileX >= maxTileX || tileY >= maxTileY) {
-            it = tiles.erase(it);
-        } else {
-            ++it;
-        }
-    }
+    tiles.eraseIf([&](i32 tileX, i32 tileY, const Tile&) {
+        return tileX < 0 || tileY < 0 || tileX >= maxTileX || tileY >= maxTileY;
+    });
+    touch();
 }
 
 Recti TiledCanvas::getBounds() const {
@@ -91,16 +195,14 @@ Recti TiledCanvas::getBounds() const {
     i32 maxX = std::numeric_limits<i32>::min();
     i32 maxY = std::numeric_limits<i32>::min();
 
-    for (const auto& [key, tile] : tiles) {
-        i32 tileX, tileY;
-        extractTileCoords(key, tileX, tileY);
+    tiles.forEach([&](i32 tileX, i32 tileY, const Tile&) {
         i32 x = tileX * static_cast<i32>(Config::TILE_SIZE);
         i32 y = tileY * static_cast<i32>(Config::TILE_SIZE);
         minX = std::min(minX, x);
         minY = std::min(minY, y);
         maxX = std::max(maxX, x + static_cast<i32>(Config::TILE_SIZE));
         maxY = std::max(maxY, y + static_cast<i32>(Config::TILE_SIZE));
-    }
+    });
 
     return Recti(minX, minY, maxX - minX, maxY - minY);
 }
@@ -114,9 +216,7 @@ Recti TiledCanvas::getContentBounds() const {
     i32 maxY = std::numeric_limits<i32>::min();
     bool foundContent = false;
 
-    for (const auto& [key, tile] : tiles) {
-        i32 tileX, tileY;
-        extractTileCoords(key, tileX, tileY);
+    tiles.forEach([&](i32 tileX, i32 tileY, const Tile& tile) {
         i32 baseX = tileX * static_cast<i32>(Config::TILE_SIZE);
         i32 baseY = tileY * static_cast<i32>(Config::TILE_SIZE);
 
@@ -124,7 +224,7 @@ Recti TiledCanvas::getContentBounds() const {
             i32 y = baseY + static_cast<i32>(ly);
             for (u32 lx = 0; lx < Config::TILE_SIZE; ++lx) {
                 i32 x = baseX + static_cast<i32>(lx);
-                u32 pixel = tile->getPixel(lx, ly);
+                u32 pixel = tile.getPixel(lx, ly);
                 if ((pixel & 0xFF) > 0) {
                     foundContent = true;
                     minX = std::min(minX, x);
@@ -134,38 +234,35 @@ Recti TiledCanvas::getContentBounds() const {
                 }
             }
         }
-    }
+    });
 
     if (!foundContent) return Recti(0, 0, 0, 0);
     return Recti(minX, minY, maxX - minX, maxY - minY);
 }
 
 Tile* TiledCanvas::getOrCreateTile(i32 tileX, i32 tileY) {
-    u64 key = makeTileKey(tileX, tileY);
-    auto it = tiles.find(key);
-    if (it == tiles.end()) {
-        auto tile = std::make_unique<Tile>();
-        Tile* ptr = tile.get();
-        tiles[key] = std::move(tile);
-        return ptr;
+    touch();
+    Tile* tile = tiles.findForWrite(tileX, tileY);
+    if (!tile) {
+        auto newTile = std::make_unique<Tile>();
+        tile = newTile.get();
+        tiles.put(tileX, tileY, std::move(newTile));
     }
-    return it->second.get();
+    return tile;
 }
 
-const Tile* TiledCanvas::getTile(i32 tileX, i32 tileY) const {
-    u64 key = makeTileKey(tileX, tileY);
-    auto it = tiles.find(key);
-    return it != tiles.end() ? it->second.get() : nullptr;
+Tile* TiledCanvas::getTile(i32 tileX, i32 tileY) {
+    touch();
+    return tiles.findForWrite(tileX, tileY);
 }
 
-Tile* TiledCanvas::getTile(i32 tileX, i32 tileY) {
-    u64 key = makeTileKey(tileX, tileY);
-    auto it = tiles.find(key);
-    return it != tiles.end() ? it->second.get() : nullptr;
+void TiledCanvas::setTile(i32 tileX, i32 tileY, TileRef tile) {
+    tiles.put(tileX, tileY, std::move(tile));
+    touch();
 }
 
-std::unordered_map<u64, std::unique_ptr<Tile>> TiledCanvas::cloneTilesInRect(const Recti& bounds) const {
-    std::unordered_map<u64, std::unique_ptr<Tile>> result;
+std::unordered_map<u64, TileRef> TiledCanvas::cloneTilesInRect(const Recti& bounds) const {
+    std::unordered_map<u64, TileRef> result;
 
     // Calculate tile range that intersects the bounds
     i32 tileSize = static_cast<i32>(Config::TILE_SIZE);
@@ -176,10 +273,8 @@ std::unordered_map<u64, std::unique_ptr<Tile>> TiledCanvas::cloneTilesInRect(con
 
     for (i32 ty = startTileY; ty <= endTileY; ++ty) {
         for (i32 tx = startTileX; tx <= endTileX; ++tx) {
-            u64 key = makeTileKey(tx, ty);
-            auto it = tiles.find(key);
-            if (it != tiles.end()) {
-                result[key] = it->second->clone();
+            if (TileRef tile = tiles.share(tx, ty)) {
+                result[makeTileKey(tx, ty)] = std::move(tile);
             }
         }
     }
@@ -187,36 +282,21 @@ std::unordered_map<u64, std::unique_ptr<Tile>> TiledCanvas::cloneTilesInRect(con
     return result;
 }
 
-std::unique_ptr<Tile> TiledCanvas::cloneTileByKey(u64 key) const {
-    auto it = tiles.find(key);
-    if (it != tiles.end()) {
-        return it->second->clone();
-    }
-    return nullptr;
+TileRef TiledCanvas::cloneTileByKey(u64 key) const {
+    i32 tileX, tileY;
+    extractTileCoords(key, tileX, tileY);
+    return tiles.share(tileX, tileY);
 }
 
-std::unordered_map<u64, std::unique_ptr<Tile>> TiledCanvas::swapTiles(
-    std::unordered_map<u64, std::unique_ptr<Tile>>& newTiles) {
-
-    std::unordered_map<u64, std::unique_ptr<Tile>> oldTiles;
+std::unordered_map<u64, TileRef> TiledCanvas::swapTiles(std::unordered_map<u64, TileRef>& newTiles) {
+    std::unordered_map<u64, TileRef> oldTiles;
+    touch();
 
     for (auto& [key, newTile] : newTiles) {
-        auto it = tiles.find(key);
-        if (it != tiles.end()) {
-            // Swap existing tile
-            oldTiles[key] = std::move(it->second);
-            if (newTile) {
-                it->second = std::move(newTile);
-            } else {
-                tiles.erase(it);
-            }
-        } else {
-            // No existing tile - oldTiles[key] stays nullptr
-            oldTiles[key] = nullptr;
-            if (newTile) {
-                tiles[key] = std::move(newTile);
-            }
-        }
+        // Missing tiles come back as nullptr, and a nullptr new tile removes
+        i32 tileX, tileY;
+        extractTileCoords(key, tileX, tileY);
+        oldTiles[key] = tiles.put(tileX, tileY, std::move(newTile));
     }
 
     return oldTiles;
@@ -6,29 +6,29 @@
 #include "tile.h"
 #include "blend.h"
 #include "primitives.h"
+#include "tile_index.h"
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include <algorithm>
+#include <atomic>
 
-// Floor division that works correctly for negative numbers
-inline i32 floorDiv(i32 a, i32 b) {
-    return (a >= 0) ? (a / b) : ((a - b + 1) / b);
-}
-
-// Positive modulo that works correctly for negative numbers
-inline u32 floorMod(i32 a, i32 b) {
-    i32 m = a % b;
-    return static_cast<u32>(m < 0 ? m + b : m);
+// Monotonic stamp shared by all canvases, so a replaced canvas never reuses a value.
+// Atomic because the view's render thread creates and writes canvases too.
+inline u64 nextCanvasRevision() {
+    static std::atomic<u64> counter{0};
+    return ++counter;
 }
 
 class TiledCanvas {
 public:
-    std::unordered_map<u64, std::unique_ptr<Tile>> tiles;
+    TileIndex tiles;
     u32 width = 0;
     u32 height = 0;
+    u64 revision = nextCanvasRevision();  // Changes whenever pixel data may have changed
 
     TiledCanvas() = default;
-    TiledCanvas(u32 w, u32 h) : width(w), height(h) {}
+    TiledCanvas(u32 w, u32 h) : width(w), height(h) { updateTileGrid(); }
 
     // Non-copyable, but movable
     TiledCanvas(const TiledCanvas&) = delete;
@@ -36,44 +36,47 @@ public:
     TiledCanvas(TiledCanvas&&) = default;
     TiledCanvas& operator=(TiledCanvas&&) = default;
 
-    // Create deep copy
+    // Create a copy. Tiles are shared copy-on-write, so this costs one handle
+    // per tile until either canvas is written to.
     std::unique_ptr<TiledCanvas> clone() const;
 
+    // Mark pixel data as modified. The mutable tile accessors do this for their
+    // callers; setPixel does not, so loops writing single pixels call it once
+    // when they are done.
+    void touch() { revision = nextCanvasRevision(); }
+
     void resize(u32 newWidth, u32 newHeight);
 
     // Pixel access - inline for hot path
     u32 getPixel(i32 x, i32 y) const {
         i32 tileX = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
         i32 tileY = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
-        u64 key = makeTileKey(tileX, tileY);
 
-        auto it = tiles.find(key);
-        if (it == tiles.end()) return 0;
+        const Tile* tile = tiles.find(tileX, tileY);
+        if (!tile) return 0;
 
         u32 localX = floorMod(x, static_cast<i32>(Config::TILE_SIZE));
         u32 localY = floorMod(y, static_cast<i32>(Config::TILE_SIZE));
-        return it->second->getPixel(localX, localY);
+        return tile->getPixel(localX, localY);
     }
 
     void setPixel(i32 x, i32 y, u32 color) {
         i32 tileX = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
         i32 tileY = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
-        u64 key = makeTileKey(tileX, tileY);
 
         u32 localX = floorMod(x, static_cast<i32>(Config::TILE_SIZE));
         u32 localY = floorMod(y, static_cast<i32>(Config::TILE_SIZE));
 
         u8 alpha = color & 0xFF;
 
-        auto it = tiles.find(key);
-        if (it == tiles.end()) {
+        Tile* tile = tiles.findForWrite(tileX, tileY);
+        if (!tile) {
             if (alpha == 0) return;
-            auto tile = std::make_unique<Tile>();
-            tile->setPixel(localX, localY, color);
-            tiles[key] = std::move(tile);
-        } else {
-            it->second->setPixel(localX, localY, color);
+            auto newTile = std::make_unique<Tile>();
+            tile = newTile.get();
+            tiles.put(tileX, tileY, std::move(newTile));
         }
+        tile->setPixel(localX, localY, color);
     }
 
     void blendPixel(i32 x, i32 y, u32 color, BlendMode mode = BlendMode::Normal, f32 opacity = 1.0f) {
@@ -90,25 +93,74 @@ public:
         setPixel(x, y, result);
     }
 
-    void clear() { tiles.clear(); }
+    // Blend all of src onto this canvas, src pixel (x, y) landing on
+    // (x + offsetX, y + offsetY), a row span at a time. Pixels outside clip
+    // (if given) are skipped and transparent runs don't create tiles.
+    void blendCanvas(const TiledCanvas& src, BlendMode mode = BlendMode::Normal, f32 opacity = 1.0f,
+                     i32 offsetX = 0, i32 offsetY = 0, const Recti* clip = nullptr);
+
+    // Shared all-transparent tile that read accessors hand out for missing tiles
+    static const Tile& emptyTile();
+
+    // Shared read-only tile with every pixel set to color. There is one per
+    // color in use, so flat areas cost a tile handle instead of a tile; writing
+    // to one gives the canvas its own copy as with any shared tile.
+    static TileRef solidTile(u32 color);
+
+    // Drop solid tiles that no canvas uses any more
+    static void releaseUnusedSolidTiles();
+
+    // Row access - pointer to the pixels from (x, y) up to the end of that tile
+    // row, with count set to how many there are (1..TILE_SIZE). Missing tiles
+    // read from the shared empty tile.
+    const u32* getRow(i32 x, i32 y, u32& count) const {
+        i32 tileX = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
+        i32 tileY = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
+        u32 localX = floorMod(x, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(y, static_cast<i32>(Config::TILE_SIZE));
+        count = Config::TILE_SIZE - localX;
+
+        const Tile* tile = tiles.find(tileX, tileY);
+        if (!tile) tile = &emptyTile();
+        return tile->pixels + localY * Config::TILE_SIZE + localX;
+    }
+
+    // Writable row access, creating the tile if needed
+    u32* getRowForWrite(i32 x, i32 y, u32& count) {
+        i32 tileX = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
+        i32 tileY = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
+        u32 localX = floorMod(x, static_cast<i32>(Config::TILE_SIZE));
+        u32 localY = floorMod(y, static_cast<i32>(Config::TILE_SIZE));
+        count = Config::TILE_SIZE - localX;
+
+        Tile* tile = getOrCreateTile(tileX, tileY);
+        return tile->pixels + localY * Config::TILE_SIZE + localX;
+    }
+
+    void clear() { tiles.clear(); touch(); }
     void clearRect(const Recti& rect);
     void fill(u32 color);
 
     // Template functions - must stay in header
     template<typename Func>
     void forEachTile(Func&& callback) const {
-        for (const auto& [key, tile] : tiles) {
-            i32 tileX, tileY;
-            extractTileCoords(key, tileX, tileY);
-            callback(tileX, tileY, *tile);
-        }
+        tiles.forEach([&](i32 tileX, i32 tileY, const Tile& tile) {
+            callback(tileX, tileY, tile);
+        });
+    }
+
+    // Visit tiles for modification in place (shared tiles are copied first)
+    template<typename Func>
+    void forEachTileForWrite(Func&& callback) {
+        touch();
+        tiles.forEachForWrite([&](i32 tileX, i32 tileY, Tile& tile) {
+            callback(tileX, tileY, tile);
+        });
     }
 
     template<typename Func>
     void forEachPixel(Func&& callback) const {
-        for (const auto& [key, tile] : tiles) {
-            i32 tileX, tileY;
-            extractTileCoords(key, tileX, tileY);
+        tiles.forEach([&](i32 tileX, i32 tileY, const Tile& tile) {
             i32 baseX = tileX * static_cast<i32>(Config::TILE_SIZE);
             i32 baseY = tileY * static_cast<i32>(Config::TILE_SIZE);
 
@@ -116,41 +168,168 @@ public:
                 i32 y = baseY + static_cast<i32>(ly);
                 for (u32 lx = 0; lx < Config::TILE_SIZE; ++lx) {
                     i32 x = baseX + static_cast<i32>(lx);
-                    u32 pixel = tile->getPixel(lx, ly);
+                    u32 pixel = tile.getPixel(lx, ly);
                     callback(x, y, pixel);
                 }
             }
+        });
+    }
+
+    // Walk a rectangle one tile row span at a time: callback(x, y, pixels, count).
+    // Missing tiles are visited with pixels from the shared empty tile.
+    template<typename Func>
+    void forEachSpan(const Recti& rect, Func&& callback) const {
+        for (i32 y = rect.y; y < rect.y + rect.h; ++y) {
+            i32 x = rect.x;
+            i32 endX = rect.x + rect.w;
+            while (x < endX) {
+                u32 count;
+                const u32* pixels = getRow(x, y, count);
+                count = std::min(count, static_cast<u32>(endX - x));
+                callback(x, y, pixels, count);
+                x += static_cast<i32>(count);
+            }
         }
     }
 
     void pruneEmptyTiles();
     void pruneOutOfBounds();
 
+    // Replace tiles in a rect (pixel coords) whose pixels all match with the
+    // shared solid tile for that color; fully transparent ones are removed
+    void compactSolidTiles(const Recti& bounds);
+    void compactSolidTiles() { compactSolidTiles(getBounds()); }
+
     Recti getBounds() const;
     Recti getContentBounds() const;
 
     size_t getTileCount() const { return tiles.size(); }
-    size_t getMemoryUsage() const { return tiles.size() * sizeof(Tile); }
+    // Solid tiles are shared, so only tiles with pixels of their own count
+    size_t getMemoryUsage() const {
+        size_t bytes = 0;
+        tiles.forEach([&](i32, i32, const Tile& tile) {
+            if (!tile.solid) bytes += sizeof(Tile);
+        });
+        return bytes;
+    }
 
-    // Tile access
+    // Tile access. The mutable accessors hand out a tile this canvas owns
+    // alone, copying it first if it is shared.
     Tile* getOrCreateTile(i32 tileX, i32 tileY);
-    const Tile* getTile(i32 tileX, i32 tileY) const;
+    const Tile* getTile(i32 tileX, i32 tileY) const { return tiles.find(tileX, tileY); }
     Tile* getTile(i32 tileX, i32 tileY);
 
-    // Undo support
-    // Clone only tiles that intersect the given rect (in pixel coords)
-    std::unordered_map<u64, std::unique_ptr<Tile>> cloneTilesInRect(const Recti& bounds) const;
+    // Shared handle to a tile, for handing it to another canvas without a copy
+    TileRef shareTile(i32 tileX, i32 tileY) const { return tiles.share(tileX, tileY); }
+
+    // Replace a whole tile (nullptr removes it)
+    void setTile(i32 tileX, i32 tileY, TileRef tile);
+    void removeTile(i32 tileX, i32 tileY) { setTile(tileX, tileY, nullptr); }
 
-    // Clone a single tile by key (returns nullptr if tile doesn't exist)
-    std::unique_ptr<Tile> cloneTileByKey(u64 key) const;
+    // Undo support. Captured tiles are shared with the canvas, not copied;
+    // the canvas copies a tile the next time it writes to it.
+    // Capture only tiles that intersect the given rect (in pixel coords)
+    std::unordered_map<u64, TileRef> cloneTilesInRect(const Recti& bounds) const;
+
+    // Capture a single tile by key (returns nullptr if tile doesn't exist)
+    TileRef cloneTileByKey(u64 key) const;
 
     // Restore tiles from a map, swapping with current tiles
     // Returns the tiles that were replaced (for redo)
-    std::unordered_map<u64, std::unique_ptr<Tile>> swapTiles(
-        std::unordered_map<u64, std::unique_ptr<Tile>>& newTiles);
+    std::unordered_map<u64, TileRef> swapTiles(std::unordered_map<u64, TileRef>& newTiles);
 
     // Get tile keys that overlap a rect (in pixel coords)
     std::vector<u64> getTileKeysInRect(const Recti& bounds) const;
+
+private:
+    // Size the tile index grid to the canvas bounds
+    void updateTileGrid() {
+        tiles.setGridSize((width + Config::TILE_SIZE - 1) / Config::TILE_SIZE,
+                          (height + Config::TILE_SIZE - 1) / Config::TILE_SIZE);
+    }
+};
+
+// Remembers the tile under the last pixel it touched, so runs of nearby
+// accesses (brush dabs, flood fills, neighbourhood sampling) only go through the
+// tile map when they cross into another tile.
+class TileReader {
+public:
+    explicit TileReader(const TiledCanvas& canvas) : canvas(&canvas) {}
+
+    u32 getPixel(i32 x, i32 y) {
+        i32 tx = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
+        i32 ty = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
+        if (tx != tileX || ty != tileY || !tile) {
+            tileX = tx;
+            tileY = ty;
+            tile = canvas->getTile(tx, ty);
+            if (!tile) tile = &TiledCanvas::emptyTile();
+        }
+        return tile->getPixel(floorMod(x, static_cast<i32>(Config::TILE_SIZE)),
+                              floorMod(y, static_cast<i32>(Config::TILE_SIZE)));
+    }
+
+private:
+    const TiledCanvas* canvas;
+    i32 tileX = 0;
+    i32 tileY = 0;
+    const Tile* tile = nullptr;
+};
+
+// Read/write counterpart of TileReader with the same semantics as the
+// TiledCanvas pixel accessors (transparent writes never create tiles)
+class TileWriter {
+public:
+    explicit TileWriter(TiledCanvas& canvas) : canvas(&canvas) {}
+
+    u32 getPixel(i32 x, i32 y) {
+        seek(x, y);
+        return tile ? tile->pixels[index] : 0;
+    }
+
+    void setPixel(i32 x, i32 y, u32 color) {
+        seek(x, y);
+        if (!writeTile) {
+            if (!tile && (color & 0xFF) == 0) return;
+            // Creates the tile, or copies it if it is shared
+            writeTile = canvas->getOrCreateTile(tileX, tileY);
+            tile = writeTile;
+        }
+        writeTile->pixels[index] = color;
+    }
+
+    void blendPixel(i32 x, i32 y, u32 color, BlendMode mode = BlendMode::Normal, f32 opacity = 1.0f) {
+        if ((color & 0xFF) == 0) return;
+        setPixel(x, y, Blend::blend(getPixel(x, y), color, mode, opacity));
+    }
+
+    void alphaBlendPixel(i32 x, i32 y, u32 color) {
+        if ((color & 0xFF) == 0) return;
+        setPixel(x, y, Blend::alphaBlend(getPixel(x, y), color));
+    }
+
+private:
+    void seek(i32 x, i32 y) {
+        i32 tx = floorDiv(x, static_cast<i32>(Config::TILE_SIZE));
+        i32 ty = floorDiv(y, static_cast<i32>(Config::TILE_SIZE));
+        if (!valid || tx != tileX || ty != tileY) {
+            tileX = tx;
+            tileY = ty;
+            valid = true;
+            writeTile = nullptr;
+            tile = canvas->tiles.find(tx, ty);
+        }
+        index = floorMod(y, static_cast<i32>(Config::TILE_SIZE)) * Config::TILE_SIZE +
+                floorMod(x, static_cast<i32>(Config::TILE_SIZE));
+    }
+
+    TiledCanvas* canvas;
+    i32 tileX = 0;
+    i32 tileY = 0;
+    bool valid = false;
+    const Tile* tile = nullptr;
+    Tile* writeTile = nullptr;   // Set once the current tile is ours to modify
+    u32 index = 0;
 };
 
 #endif
@@ -327,6 +327,7 @@ void MoveTool::onMouseDown(Document& doc, const ToolEvent& e) {
                         }
                     }
                 }
+                pixelLayer->canvas.touch();
 
                 // Set up document's floating content reference
                 doc.floatingContent.pixels = floatingPixels.get();
@@ -334,6 +335,7 @@ void MoveTool::onMouseDown(Document& doc, const ToolEvent& e) {
                 doc.floatingContent.currentOffset = Vec2(0, 0);
                 doc.floatingContent.sourceLayer = pixelLayer;
                 doc.floatingContent.active = true;
+                doc.notifyChanged(selBounds.toRect());
             }
 
             getAppState().needsRedraw = true;
@@ -572,7 +574,10 @@ void MoveTool::onMouseUp(Document& doc, const ToolEvent& e) {
                     }
                 }
             }
+            layer->canvas.touch();
             // Selection mask already moved during drag, no need to offset again
+            doc.notifyChanged(Rect(static_cast<f32>(origBounds.x + offsetX), static_cast<f32>(origBounds.y + offsetY),
+                                   static_cast<f32>(floatingPixels->width), static_cast<f32>(floatingPixels->height)));
         }
 
         // Clear floating content
@@ -629,6 +634,7 @@ void MoveTool::onKeyDown(Document& doc, i32 keyCode) {
                             }
                         }
                     }
+                    pixelLayer->canvas.touch();
                 }
                 floatingPixels.reset();
                 doc.floatingContent.clear();
@@ -669,6 +675,7 @@ void MoveTool::onKeyDown(Document& doc, i32 keyCode) {
                         }
                     }
                 }
+                pixelLayer->canvas.touch();
 
                 doc.floatingContent.pixels = floatingPixels.get();
                 doc.floatingContent.originalBounds = selBounds;
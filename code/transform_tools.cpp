@@ -42,6 +42,7 @@ void CropTool::apply(Document& doc) {
                 });
 
                 pixelLayer->canvas = std::move(newCanvas);
+                pixelLayer->canvas.compactSolidTiles();
             } else {
                 // Transformed layer: just adjust position in document space
                 // The canvas stays the same (it's in layer space)
@@ -328,6 +329,9 @@ void GradientTool::onMouseUp(Document& doc, const ToolEvent& e) {
                            fgColor, bgColor, 0, 0, doc.width, doc.height);
     }
 
+    // Past the gradient's end points every pixel is the same color
+    layer->canvas.compactSolidTiles(fullBounds);
+
     // Commit undo
     doc.commitUndo();
 
@@ -375,6 +379,7 @@ void GradientTool::expandLayerToDocument(PixelLayer* layer, u32 docWidth, u32 do
 
     // Replace canvas and update position
     layer->canvas = std::move(newCanvas);
+    layer->canvas.compactSolidTiles();
     layer->transform.position.x = static_cast<f32>(minX);
     layer->transform.position.y = static_cast<f32>(minY);
 }
@@ -390,6 +395,7 @@ void GradientTool::applyLinearGradient(TiledCanvas& canvas, const Selection& sel
 
     Vec2 norm = dir.normalized();
 
+    TileWriter writer(canvas);
     for (u32 y = 0; y < canvas.height; ++y) {
         for (u32 x = 0; x < canvas.width; ++x) {
             // Convert to document coords for bounds/selection check
@@ -420,7 +426,7 @@ void GradientTool::applyLinearGradient(TiledCanvas& canvas, const Selection& sel
                 }
             }
 
-            canvas.blendPixel(x, y, pixel);
+            writer.blendPixel(x, y, pixel);
         }
     }
 }
@@ -433,6 +439,7 @@ void GradientTool::applyRadialGradient(TiledCanvas& canvas, const Selection& sel
     f32 radius = Vec2::distance(center, edge);
     if (radius < 1.0f) return;
 
+    TileWriter writer(canvas);
     for (u32 y = 0; y < canvas.height; ++y) {
         for (u32 x = 0; x < canvas.width; ++x) {
             // Convert to document coords for bounds/selection check
@@ -463,7 +470,7 @@ void GradientTool::applyRadialGradient(TiledCanvas& canvas, const Selection& sel
                 }
             }
 
-            canvas.blendPixel(x, y, pixel);
+            writer.blendPixel(x, y, pixel);
         }
     }
 }
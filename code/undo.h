@@ -18,17 +18,18 @@ class Document;
 struct TileDelta {
     i32 layerIndex = -1;
 
-    // Original tiles (before the operation)
-    std::unordered_map<u64, std::unique_ptr<Tile>> originalTiles;
+    // Original tiles (before the operation), shared with the layer until it
+    // writes to them
+    std::unordered_map<u64, TileRef> originalTiles;
 
     // New tiles (after the operation, for redo)
-    std::unordered_map<u64, std::unique_ptr<Tile>> newTiles;
+    std::unordered_map<u64, TileRef> newTiles;
 
     TileDelta() = default;
     TileDelta(TileDelta&&) = default;
     TileDelta& operator=(TileDelta&&) = default;
 
-    // Non-copyable due to unique_ptr
+    // Non-copyable (steps are moved into the history)
     TileDelta(const TileDelta&) = delete;
     TileDelta& operator=(const TileDelta&) = delete;
 };
@@ -181,11 +181,13 @@ void WasmWindow::present(const u32* pixels, u32 w, u32 h) {
     }, pixels, w, h);
 }
 
-void WasmWindow::presentPartial(const u32* pixels, u32 w, u32 h, i32 dx, i32 dy, i32 dw, i32 dh) {
-    // Call JavaScript to render only the dirty region
-    EM_ASM({
-        js_render_frame_partial($0, $1, $2, $3, $4, $5, $6);
-    }, pixels, w, h, dx, dy, dw, dh);
+void WasmWindow::presentPartial(const u32* pixels, u32 w, u32 h, const Recti* rects, u32 count) {
+    // Call JavaScript to render only the dirty regions
+    for (u32 i = 0; i < count; ++i) {
+        EM_ASM({
+            js_render_frame_partial($0, $1, $2, $3, $4, $5, $6);
+        }, pixels, w, h, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+    }
 }
 
 bool WasmWindow::processEvents() {
@@ -170,6 +170,16 @@ public:
         return Rect(pos.x, pos.y, bounds.w, bounds.h);
     }
 
+    // Pixels globalBounds() touches, rounded outward
+    Recti globalPixelBounds() const {
+        Rect gb = globalBounds();
+        i32 x0 = static_cast<i32>(std::floor(gb.x));
+        i32 y0 = static_cast<i32>(std::floor(gb.y));
+        i32 x1 = static_cast<i32>(std::ceil(gb.x + gb.w));
+        i32 y1 = static_cast<i32>(std::ceil(gb.y + gb.h));
+        return Recti(x0, y0, x1 - x0, y1 - y0);
+    }
+
     // Content rect (bounds minus padding)
     Rect contentRect() const {
         return Rect(paddingLeft, paddingTop,
@@ -217,6 +227,13 @@ public:
 
     void renderChildren(Framebuffer& fb) {
         for (auto& child : children) {
+            // Partial redraws render the tree once per dirty rect, so skip
+            // leaves the clip misses. Containers are still walked, since
+            // layouts can leave a child hanging over its parent's edge.
+            if (child->children.empty() && fb.hasClip() &&
+                !fb.currentClip().intersects(child->globalPixelBounds())) {
+                continue;
+            }
             child->render(fb);
         }
     }
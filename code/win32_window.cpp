@@ -3,6 +3,7 @@
 #include <windowsx.h>
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
 
 // Static member
 bool Win32Window::classRegistered = false;
@@ -374,21 +375,9 @@ void Win32Window::present(const u32* pixels, u32 w, u32 h) {
         }
     }
 
-    // Copy with RGBA to BGR conversion
-    // App pixel format: 0xRRGGBBAA (R in high byte, A in low byte)
-    // Windows DIB format: 0x00RRGGBB (B in low byte, high byte unused)
-    const u32* src = pixels;
-    u32* dst = backBufferPixels;
-    u32 count = w * h;
-
-    for (u32 i = 0; i < count; ++i) {
-        u32 rgba = src[i];
-        u8 r = (rgba >> 24) & 0xFF;
-        u8 g = (rgba >> 16) & 0xFF;
-        u8 b = (rgba >> 8) & 0xFF;
-        // Alpha is ignored for window content
-        dst[i] = (r << 16) | (g << 8) | b;
-    }
+    // Frames are already in the DIB's 0xAARRGGBB layout (PixelFormat);
+    // the alpha byte is ignored for window content
+    std::memcpy(backBufferPixels, pixels, static_cast<size_t>(w) * h * sizeof(u32));
 
     // Blit to window
     BitBlt(hdcWindow, 0, 0, w, h, hdcBackBuffer, 0, 0, SRCCOPY);
@@ -545,6 +534,12 @@ bool Win32Window::processEvents() {
     return true;
 }
 
+void Win32Window::waitForEvents(i32 timeoutMs) {
+    // MWMO_INPUTAVAILABLE also returns for messages already in the queue
+    DWORD timeout = timeoutMs < 0 ? INFINITE : static_cast<DWORD>(timeoutMs);
+    MsgWaitForMultipleObjectsEx(0, nullptr, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+}
+
 LRESULT CALLBACK Win32Window::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     Win32Window* window = nullptr;
 
@@ -99,6 +99,7 @@ struct Win32Window : public PlatformWindow {
 
     // Event processing
     bool processEvents() override;
+    void waitForEvents(i32 timeoutMs) override;
 
     // Window procedure callback
     static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
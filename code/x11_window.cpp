@@ -5,6 +5,37 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <poll.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+namespace {
+
+// XShmAttach reports failure (e.g. on a remote display) as an asynchronous
+// protocol error, so it is caught with a temporary error handler
+bool shmAttachFailed = false;
+
+int onShmAttachError(Display*, XErrorEvent*) {
+    shmAttachFailed = true;
+    return 0;
+}
+
+Bool isShmCompletion(Display*, XEvent* event, XPointer arg) {
+    return event->type == *reinterpret_cast<i32*>(arg) ? True : False;
+}
+
+// Copy one rect of a frame w pixels wide into an image holding the whole
+// frame at the same coordinates. Frames are already in the visual's layout
+// (PixelFormat), so rows copy as they are.
+void copyToImage(const u32* pixels, u32 w, const Recti& rect, char* dstData, u32 dstStride) {
+    for (i32 y = rect.y; y < rect.y + rect.h; ++y) {
+        std::memcpy(dstData + static_cast<size_t>(y) * dstStride + static_cast<size_t>(rect.x) * sizeof(u32),
+                    pixels + static_cast<size_t>(y) * w + rect.x,
+                    static_cast<size_t>(rect.w) * sizeof(u32));
+    }
+}
+
+}
 
 bool X11Window::create(u32 w, u32 h, const char* title) {
     // Open display connection
@@ -71,6 +102,12 @@ bool X11Window::create(u32 w, u32 h, const char* title) {
     // Create graphics context
     gc = XCreateGC(display, window, 0, nullptr);
 
+    // Present through shared memory when the server offers it
+    shmAvailable = XShmQueryExtension(display) == True;
+    if (shmAvailable) {
+        shmCompletionEvent = XShmGetEventBase(display) + ShmCompletion;
+    }
+
     // Setup input method for text input
     xim = XOpenIM(display, nullptr, nullptr, nullptr);
     if (xim) {
@@ -393,9 +430,102 @@ void X11Window::setCursor(i32 resizeDirection) {
     XFlush(display);
 }
 
+bool X11Window::createShmImage(ShmImage& shm, u32 w, u32 h) {
+    shm.image = XShmCreateImage(display, visual, depth, ZPixmap, nullptr, &shm.info, w, h);
+    if (!shm.image) return false;
+
+    shm.info.shmid = shmget(IPC_PRIVATE,
+                            static_cast<size_t>(shm.image->bytes_per_line) * shm.image->height,
+                            IPC_CREAT | 0600);
+    if (shm.info.shmid < 0) {
+        XDestroyImage(shm.image);
+        shm.image = nullptr;
+        return false;
+    }
+
+    shm.info.shmaddr = static_cast<char*>(shmat(shm.info.shmid, nullptr, 0));
+    if (shm.info.shmaddr == reinterpret_cast<char*>(-1)) {
+        shmctl(shm.info.shmid, IPC_RMID, nullptr);
+        XDestroyImage(shm.image);
+        shm.image = nullptr;
+        return false;
+    }
+    shm.image->data = shm.info.shmaddr;
+    shm.info.readOnly = False;
+
+    shmAttachFailed = false;
+    XErrorHandler previousHandler = XSetErrorHandler(onShmAttachError);
+    XShmAttach(display, &shm.info);
+    XSync(display, False);
+    XSetErrorHandler(previousHandler);
+
+    // Mark the segment for removal now so it can't outlive the process;
+    // it stays valid until both sides detach
+    shmctl(shm.info.shmid, IPC_RMID, nullptr);
+
+    if (shmAttachFailed) {
+        shmdt(shm.info.shmaddr);
+        shm.image->data = nullptr;
+        XDestroyImage(shm.image);
+        shm.image = nullptr;
+        return false;
+    }
+
+    shm.pending = false;
+    return true;
+}
+
+void X11Window::destroyShmImage(ShmImage& shm) {
+    if (!shm.image) return;
+
+    // The server may still be reading; detach and sync before unmapping
+    XShmDetach(display, &shm.info);
+    XSync(display, False);
+    shmdt(shm.info.shmaddr);
+
+    // Don't let XDestroyImage free the shared memory
+    shm.image->data = nullptr;
+    XDestroyImage(shm.image);
+    shm.image = nullptr;
+    shm.pending = false;
+}
+
+void X11Window::waitForShmCompletion(ShmImage& shm) {
+    // Only completion events are taken off the queue; input stays for processEvents()
+    while (shm.pending) {
+        XEvent event;
+        XIfEvent(display, &event, isShmCompletion, reinterpret_cast<XPointer>(&shmCompletionEvent));
+        handleShmCompletion(event);
+    }
+}
+
+void X11Window::handleShmCompletion(const XEvent& event) {
+    const XShmCompletionEvent& completion = reinterpret_cast<const XShmCompletionEvent&>(event);
+    for (ShmImage& shm : shmImages) {
+        if (shm.image && shm.info.shmseg == completion.shmseg) {
+            shm.pending = false;
+        }
+    }
+}
+
 bool X11Window::createImageBuffer(u32 w, u32 h) {
     destroyImageBuffer();
 
+    if (shmAvailable) {
+        if (createShmImage(shmImages[0], w, h) && createShmImage(shmImages[1], w, h)) {
+            shmNext = 0;
+            imageWidth = w;
+            imageHeight = h;
+            return true;
+        }
+
+        // Remote display or no shared memory: use XPutImage from now on
+        destroyShmImage(shmImages[0]);
+        destroyShmImage(shmImages[1]);
+        shmAvailable = false;
+        fprintf(stderr, "MIT-SHM unavailable, presenting with XPutImage\n");
+    }
+
     // Allocate pixel buffer (BGRA format for X11)
     imageBuffer = new (std::nothrow) u32[w * h];
     if (!imageBuffer) {
@@ -429,6 +559,9 @@ bool X11Window::createImageBuffer(u32 w, u32 h) {
 }
 
 void X11Window::destroyImageBuffer() {
+    destroyShmImage(shmImages[0]);
+    destroyShmImage(shmImages[1]);
+
     if (image) {
         // Don't let XDestroyImage free our buffer, we manage it
         image->data = nullptr;
@@ -455,27 +588,73 @@ void X11Window::present(const u32* pixels, u32 w, u32 h) {
         }
     }
 
-    // Copy pixels with format conversion (RGBA -> BGRA for X11)
-    // X11 typically expects BGRA (or BGRX) in 32-bit depth
-    const u32* src = pixels;
-    u32* dst = imageBuffer;
-    u32 count = w * h;
-
-    for (u32 i = 0; i < count; ++i) {
-        u32 rgba = src[i];
-        // RGBA to BGRA: swap R and B
-        u8 r = (rgba >> 24) & 0xFF;
-        u8 g = (rgba >> 16) & 0xFF;
-        u8 b = (rgba >> 8) & 0xFF;
-        u8 a = rgba & 0xFF;
-        dst[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    if (shmAvailable) {
+        // Alternate images so copying this frame doesn't wait for the
+        // server to finish with the last one
+        ShmImage& shm = shmImages[shmNext];
+        shmNext ^= 1;
+        waitForShmCompletion(shm);
+
+        copyToImage(pixels, w, Recti(0, 0, w, h), shm.image->data,
+                     static_cast<u32>(shm.image->bytes_per_line));
+        XShmPutImage(display, window, gc, shm.image, 0, 0, 0, 0, w, h, True);
+        shm.pending = true;
+        XFlush(display);
+        return;
     }
 
-    // Blit to window
+    // Copy the pixels into the image, then send them over the socket
+    copyToImage(pixels, w, Recti(0, 0, w, h), image->data, static_cast<u32>(image->bytes_per_line));
     XPutImage(display, window, gc, image, 0, 0, 0, 0, w, h);
     XFlush(display);
 }
 
+void X11Window::presentPartial(const u32* pixels, u32 w, u32 h, const Recti* rects, u32 count) {
+    if (!display || !window || !pixels) return;
+
+    // New image buffers need a full frame first
+    if (w != imageWidth || h != imageHeight) {
+        present(pixels, w, h);
+        return;
+    }
+
+    Recti frame(0, 0, static_cast<i32>(w), static_cast<i32>(h));
+
+    if (shmAvailable) {
+        // Only the rects are put, so whatever older frame the rest of this
+        // image holds is never shown
+        ShmImage& shm = shmImages[shmNext];
+        shmNext ^= 1;
+        waitForShmCompletion(shm);
+
+        // The server handles requests in order, so a completion event for
+        // the last put means it is done with the whole image
+        i32 last = -1;
+        for (u32 i = 0; i < count; ++i) {
+            if (rects[i].intersects(frame)) last = static_cast<i32>(i);
+        }
+        for (i32 i = 0; i <= last; ++i) {
+            if (!rects[i].intersects(frame)) continue;
+            Recti r = rects[i].intersection(frame);
+            copyToImage(pixels, w, r, shm.image->data, static_cast<u32>(shm.image->bytes_per_line));
+            XShmPutImage(display, window, gc, shm.image, r.x, r.y, r.x, r.y,
+                         static_cast<u32>(r.w), static_cast<u32>(r.h), i == last ? True : False);
+        }
+        shm.pending = last >= 0;
+        XFlush(display);
+        return;
+    }
+
+    for (u32 i = 0; i < count; ++i) {
+        if (!rects[i].intersects(frame)) continue;
+        Recti r = rects[i].intersection(frame);
+        copyToImage(pixels, w, r, image->data, static_cast<u32>(image->bytes_per_line));
+        XPutImage(display, window, gc, image, r.x, r.y, r.x, r.y,
+                  static_cast<u32>(r.w), static_cast<u32>(r.h));
+    }
+    XFlush(display);
+}
+
 void X11Window::updateDpiScale() {
     dpiScale = 1.0f;
 
@@ -703,6 +882,20 @@ std::string X11Window::parseUriList(const char* data, unsigned long length) {
     return "";
 }
 
+void X11Window::waitForEvents(i32 timeoutMs) {
+    if (!display) return;
+
+    // XPending also flushes queued requests. Events can already be queued
+    // here, read by calls made after processEvents() (waiting on a
+    // shared-memory image, for one).
+    if (XPending(display) > 0) return;
+
+    pollfd connection = {};
+    connection.fd = ConnectionNumber(display);
+    connection.events = POLLIN;
+    poll(&connection, 1, timeoutMs);
+}
+
 bool X11Window::processEvents() {
     if (!display) return false;
 
@@ -710,6 +903,12 @@ bool X11Window::processEvents() {
         XEvent event;
         XNextEvent(display, &event);
 
+        // The server finished reading a shared-memory image
+        if (shmAvailable && event.type == shmCompletionEvent) {
+            handleShmCompletion(event);
+            continue;
+        }
+
         // Filter events for XIM
         if (xic && XFilterEvent(&event, X11_NONE)) {
             continue;
@@ -6,6 +6,7 @@
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
 #include <X11/Xresource.h>
+#include <X11/extensions/XShm.h>
 
 // Save X11's None value before undefining the macro
 // X11 defines None as 0L, which conflicts with our enum values
@@ -26,12 +27,26 @@ struct X11Window : public PlatformWindow {
     Visual* visual = nullptr;
     i32 depth = 0;
 
-    // Image buffer for software rendering
+    // Image buffer for software rendering (used when MIT-SHM is unavailable)
     XImage* image = nullptr;
     u32* imageBuffer = nullptr;
     u32 imageWidth = 0;
     u32 imageHeight = 0;
 
+    // MIT-SHM presentation: two shared-memory images the server reads in
+    // place. present() and presentPartial() fill one while the server may
+    // still be reading the other, and only reuse an image after its
+    // ShmCompletion event arrives.
+    struct ShmImage {
+        XImage* image = nullptr;
+        XShmSegmentInfo info = {};
+        bool pending = false;   // XShmPutImage sent, completion not yet seen
+    };
+    bool shmAvailable = false;
+    i32 shmCompletionEvent = 0;
+    ShmImage shmImages[2];
+    u32 shmNext = 0;
+
     // Window close handling
     Atom wmDeleteMessage;
     Atom wmProtocols;
@@ -104,9 +119,11 @@ struct X11Window : public PlatformWindow {
 
     // Rendering
     void present(const u32* pixels, u32 w, u32 h) override;
+    void presentPartial(const u32* pixels, u32 w, u32 h, const Recti* rects, u32 count) override;
 
     // Event processing
     bool processEvents() override;
+    void waitForEvents(i32 timeoutMs) override;
 
     // DPI handling
     void updateDpiScale();
@@ -117,6 +134,10 @@ struct X11Window : public PlatformWindow {
 private:
     bool createImageBuffer(u32 w, u32 h);
     void destroyImageBuffer();
+    bool createShmImage(ShmImage& shm, u32 w, u32 h);
+    void destroyShmImage(ShmImage& shm);
+    void waitForShmCompletion(ShmImage& shm);
+    void handleShmCompletion(const XEvent& event);
     void initXdnd();
     void sendXdndStatus(Window source, bool accept);
     void sendXdndFinished(Window source, bool accepted);